@@ -0,0 +1,130 @@
+//
+//  CircleTessellation.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+import Accelerate
+
+/// Shared unit-circle templates for drawing many circles (accuracy rings, geofences) as
+/// polygons.
+///
+/// The segment count comes from the circle's on-screen radius at the current zoom, so the
+/// chord never strays more than `tolerance` points from the true circle, and is rounded up
+/// to a power of two so a handful of templates serve every circle. A circle's vertices are
+/// then one scale-and-offset of the template's cosines and sines (vDSP), without any
+/// trigonometry per circle.
+///
+/// Circles are laid out in the local tangent plane, which is exact to well under a meter for
+/// radii up to tens of kilometers. `NMAMapCircle` keeps its own tessellation; use this where
+/// many circles are drawn as `NMAMapPolygon`s or the outline is needed in app code.
+final class CircleTessellation {
+
+    static let shared = CircleTessellation()
+
+    static let minimumSegments = 16
+    static let maximumSegments = 1024
+
+    /// Maximum distance between chord and circle, in screen points.
+    let tolerance: Double
+
+    fileprivate var templates: [Int: (cosines: [Double], sines: [Double])] = [:]
+    fileprivate let lock = NSLock()
+
+    init(tolerance: Double = 0.25) {
+        self.tolerance = tolerance
+    }
+
+    // MARK: Segment count
+
+    /// Segments needed for a circle `radius` screen points wide.
+    func segmentCount(radiusInPoints radius: Double) -> Int {
+        guard radius > tolerance else { return CircleTessellation.minimumSegments }
+        // Sagitta r * (1 - cos(pi / n)) <= tolerance.
+        let needed = Double.pi / acos(1 - tolerance / radius)
+        var segments = CircleTessellation.minimumSegments
+        while Double(segments) < needed && segments < CircleTessellation.maximumSegments {
+            segments *= 2
+        }
+        return segments
+    }
+
+    /// Segments for a circle of `radius` meters at `latitude`, drawn at `zoomLevel`.
+    func segmentCount(radius: Double, latitude: Double, zoomLevel: Float) -> Int {
+        let worldPoints = 256 * pow(2, Double(zoomLevel))
+        let metersPerPoint = 2 * Double.pi * GeoBatch.earthRadius * cos(latitude * GeoBatch.degreesToRadians) / worldPoints
+        return segmentCount(radiusInPoints: radius / max(metersPerPoint, Double.leastNormalMagnitude))
+    }
+
+    // MARK: Templates
+
+    /// Cosines and sines of `segments` evenly spaced angles, counter-clockwise from east.
+    func template(segments: Int) -> (cosines: [Double], sines: [Double]) {
+        lock.lock()
+        defer { lock.unlock() }
+        if let cached = templates[segments] {
+            return cached
+        }
+        var angles = [Double](repeating: 0, count: segments)
+        var start = 0.0, step = 2 * Double.pi / Double(segments)
+        vDSP_vrampD(&start, &step, &angles, 1, vDSP_Length(segments))
+        var cosines = [Double](repeating: 0, count: segments)
+        var sines = [Double](repeating: 0, count: segments)
+        var n = Int32(segments)
+        vvsincos(&sines, &cosines, angles, &n)
+        templates[segments] = (cosines, sines)
+        return (cosines, sines)
+    }
+
+    // MARK: Outlines
+
+    /// Outline of one circle with `segments` vertices.
+    func vertices(latitude: Double, longitude: Double, radius: Double, segments: Int) -> GeoCoordinateBuffer {
+        let unit = template(segments: segments)
+        var latitudeScale = radius / GeoBatch.earthRadius * GeoBatch.radiansToDegrees
+        var longitudeScale = latitudeScale / max(cos(latitude * GeoBatch.degreesToRadians), 1e-6)
+        var centerLatitude = latitude, centerLongitude = longitude
+        var latitudes = [Double](repeating: 0, count: segments)
+        var longitudes = [Double](repeating: 0, count: segments)
+        let length = vDSP_Length(segments)
+        vDSP_vsmsaD(unit.sines, 1, &latitudeScale, &centerLatitude, &latitudes, 1, length)
+        vDSP_vsmsaD(unit.cosines, 1, &longitudeScale, &centerLongitude, &longitudes, 1, length)
+        return GeoCoordinateBuffer(latitudes: latitudes, longitudes: longitudes)
+    }
+
+    /// Outline of a circle with the segment count for `zoomLevel`.
+    func vertices(center: NMAGeoCoordinates, radius: Double, zoomLevel: Float) -> GeoCoordinateBuffer {
+        let segments = segmentCount(radius: radius, latitude: center.latitude, zoomLevel: zoomLevel)
+        return vertices(latitude: center.latitude, longitude: center.longitude, radius: radius, segments: segments)
+    }
+
+    /// Outlines of many circles at once, on the worker pool.
+    func vertices(centers: GeoCoordinateBuffer, radii: [Double], zoomLevel: Float) -> [GeoCoordinateBuffer] {
+        precondition(centers.count == radii.count, "CircleTessellation: center/radius count mismatch")
+        var outlines = [GeoCoordinateBuffer](repeating: GeoCoordinateBuffer(), count: centers.count)
+        let lats = centers.latitudes, lons = centers.longitudes
+        // Segment counts and templates up front, so the workers only hit the cache.
+        var counts = [Int](repeating: 0, count: centers.count)
+        for i in 0..<centers.count {
+            counts[i] = segmentCount(radius: radii[i], latitude: lats[i], zoomLevel: zoomLevel)
+            _ = template(segments: counts[i])
+        }
+        let count = outlines.count
+        outlines.withUnsafeMutableBufferPointer { results in
+            GeoBatch.concurrentChunks(count: count, minimumChunk: 256, alignment: 1) { range in
+                for i in range {
+                    results[i] = vertices(latitude: lats[i], longitude: lons[i], radius: radii[i], segments: counts[i])
+                }
+            }
+        }
+        return outlines
+    }
+
+    /// A polygon for the circle, for drawing many circles where `NMAMapCircle` is too slow.
+    func polygon(center: NMAGeoCoordinates, radius: Double, zoomLevel: Float) -> NMAMapPolygon {
+        return NMAMapPolygon(buffer: vertices(center: center, radius: radius, zoomLevel: zoomLevel))
+    }
+}
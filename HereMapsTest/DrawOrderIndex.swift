@@ -0,0 +1,323 @@
+//
+//  DrawOrderIndex.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+
+/// Draw order of map objects and tile layers by `zIndex`, kept up to date per change
+/// instead of re-sorting the whole list.
+///
+/// Objects are ordered by (zIndex, sequence), where the sequence is taken when the object is
+/// added or its zIndex changes, so every zIndex forms one contiguous bucket in insertion
+/// order. The order lives in a treap (randomized balanced tree) with subtree sizes, so
+/// add, remove, zIndex change, position lookup and object-at-position are O(log n).
+///
+/// `load(_:)` replaces the contents in one go: a stable parallel radix sort on zIndex
+/// (`HilbertSort.sortedPermutation`) and a linear-time tree build.
+///
+/// Set zIndex through the index, which forwards it to the object.
+final class DrawOrderIndex {
+
+    fileprivate var objects: [NSObject?] = []
+    fileprivate var zIndices: [UInt] = []
+    fileprivate var sequences: [UInt64] = []
+    fileprivate var priorities: [UInt32] = []
+    fileprivate var left: [Int32] = []
+    fileprivate var right: [Int32] = []
+    fileprivate var sizes: [Int32] = []
+    fileprivate var freeNodes: [Int32] = []
+    fileprivate var nodes: [ObjectIdentifier: Int32] = [:]
+    fileprivate var root: Int32 = -1
+    fileprivate var nextSequence: UInt64 = 0
+    fileprivate var random: UInt32 = 0x9E3779B9
+
+    init() {
+    }
+
+    var count: Int {
+        return nodes.count
+    }
+
+    // MARK: Objects
+
+    func add(_ object: NMAMapObject) {
+        add(object, zIndex: object.zIndex)
+    }
+
+    func add(_ layer: NMAMapTileLayer) {
+        add(layer, zIndex: layer.zIndex)
+    }
+
+    func remove(_ object: NSObject) {
+        guard let node = nodes.removeValue(forKey: ObjectIdentifier(object)) else { return }
+        root = detach(node, from: root)
+        objects[Int(node)] = nil
+        freeNodes.append(node)
+    }
+
+    func removeAll() {
+        objects = []
+        zIndices = []
+        sequences = []
+        priorities = []
+        left = []
+        right = []
+        sizes = []
+        freeNodes = []
+        nodes = [:]
+        root = -1
+    }
+
+    /// Sets `zIndex` on the object and moves it to the end of its new bucket. Returns the
+    /// object's new draw position.
+    @discardableResult
+    func setZIndex(_ zIndex: UInt, of object: NSObject) -> Int {
+        if let mapObject = object as? NMAMapObject {
+            mapObject.zIndex = zIndex
+        } else if let layer = object as? NMAMapTileLayer {
+            layer.zIndex = zIndex
+        }
+        if let node = nodes[ObjectIdentifier(object)] {
+            root = detach(node, from: root)
+            zIndices[Int(node)] = zIndex
+            sequences[Int(node)] = takeSequence()
+            left[Int(node)] = -1
+            right[Int(node)] = -1
+            sizes[Int(node)] = 1
+            root = attach(node, to: root)
+        } else {
+            add(object, zIndex: zIndex)
+        }
+        return position(of: object)!
+    }
+
+    /// Replaces the contents with `newObjects`; objects with equal zIndex keep their order
+    /// in the array.
+    func load(_ newObjects: [NSObject]) {
+        removeAll()
+        let count = newObjects.count
+        guard count > 0 else { return }
+        var keys = [UInt](repeating: 0, count: count)
+        for (i, object) in newObjects.enumerated() {
+            keys[i] = DrawOrderIndex.zIndex(of: object)
+        }
+        let order: [Int]
+        if let largest = keys.max(), largest <= UInt(UInt32.max) {
+            order = HilbertSort.sortedPermutation(keys: keys.map { UInt32($0) })
+        } else {
+            order = (0..<count).sorted { keys[$0] != keys[$1] ? keys[$0] < keys[$1] : $0 < $1 }
+        }
+
+        objects.reserveCapacity(count)
+        for i in order {
+            let node = newNode(newObjects[i], zIndex: keys[i])
+            nodes[ObjectIdentifier(newObjects[i])] = node
+        }
+        // Nodes are already in key order: build the treap along its right spine.
+        var spine = [Int32]()
+        for node in 0..<Int32(count) {
+            var last: Int32 = -1
+            while let top = spine.last, priorities[Int(top)] < priorities[Int(node)] {
+                last = spine.removeLast()
+                update(last)
+            }
+            left[Int(node)] = last
+            if let top = spine.last {
+                right[Int(top)] = node
+            }
+            spine.append(node)
+        }
+        root = spine.first ?? -1
+        while let node = spine.popLast() {
+            update(node)
+        }
+    }
+
+    // MARK: Order
+
+    /// Draw position (0 is drawn first) of the object.
+    func position(of object: NSObject) -> Int? {
+        guard let node = nodes[ObjectIdentifier(object)] else { return nil }
+        var position = 0
+        var current = root
+        while current >= 0 {
+            if current == node {
+                return position + size(left[Int(current)])
+            }
+            if isLess(node, current) {
+                current = left[Int(current)]
+            } else {
+                position += size(left[Int(current)]) + 1
+                current = right[Int(current)]
+            }
+        }
+        return nil
+    }
+
+    /// Object drawn at `position`.
+    func object(at position: Int) -> NSObject {
+        precondition(position >= 0 && position < count, "DrawOrderIndex: position out of range")
+        var remaining = position
+        var current = root
+        while true {
+            let leftSize = size(left[Int(current)])
+            if remaining < leftSize {
+                current = left[Int(current)]
+            } else if remaining == leftSize {
+                return objects[Int(current)]!
+            } else {
+                remaining -= leftSize + 1
+                current = right[Int(current)]
+            }
+        }
+    }
+
+    /// All objects, bottom first.
+    func orderedObjects() -> [NSObject] {
+        var result = [NSObject]()
+        result.reserveCapacity(count)
+        var stack = [Int32]()
+        var current = root
+        while current >= 0 || !stack.isEmpty {
+            while current >= 0 {
+                stack.append(current)
+                current = left[Int(current)]
+            }
+            let node = stack.removeLast()
+            result.append(objects[Int(node)]!)
+            current = right[Int(node)]
+        }
+        return result
+    }
+
+    // MARK: Treap
+
+    fileprivate static func zIndex(of object: NSObject) -> UInt {
+        if let mapObject = object as? NMAMapObject {
+            return mapObject.zIndex
+        }
+        if let layer = object as? NMAMapTileLayer {
+            return layer.zIndex
+        }
+        return 0
+    }
+
+    fileprivate func add(_ object: NSObject, zIndex: UInt) {
+        guard nodes[ObjectIdentifier(object)] == nil else { return }
+        let node = newNode(object, zIndex: zIndex)
+        nodes[ObjectIdentifier(object)] = node
+        root = attach(node, to: root)
+    }
+
+    fileprivate func newNode(_ object: NSObject, zIndex: UInt) -> Int32 {
+        // xorshift32
+        random ^= random << 13
+        random ^= random >> 17
+        random ^= random << 5
+        let sequence = takeSequence()
+        if let node = freeNodes.popLast() {
+            let i = Int(node)
+            objects[i] = object
+            zIndices[i] = zIndex
+            sequences[i] = sequence
+            priorities[i] = random
+            left[i] = -1
+            right[i] = -1
+            sizes[i] = 1
+            return node
+        }
+        objects.append(object)
+        zIndices.append(zIndex)
+        sequences.append(sequence)
+        priorities.append(random)
+        left.append(-1)
+        right.append(-1)
+        sizes.append(1)
+        return Int32(objects.count - 1)
+    }
+
+    fileprivate func takeSequence() -> UInt64 {
+        nextSequence += 1
+        return nextSequence
+    }
+
+    fileprivate func isLess(_ a: Int32, _ b: Int32) -> Bool {
+        let za = zIndices[Int(a)], zb = zIndices[Int(b)]
+        return za != zb ? za < zb : sequences[Int(a)] < sequences[Int(b)]
+    }
+
+    fileprivate func size(_ node: Int32) -> Int {
+        return node >= 0 ? Int(sizes[Int(node)]) : 0
+    }
+
+    fileprivate func update(_ node: Int32) {
+        sizes[Int(node)] = Int32(1 + size(left[Int(node)]) + size(right[Int(node)]))
+    }
+
+    /// Inserts a detached node into the subtree rooted at `tree`; returns the new root.
+    fileprivate func attach(_ node: Int32, to tree: Int32) -> Int32 {
+        guard tree >= 0 else { return node }
+        if priorities[Int(node)] > priorities[Int(tree)] {
+            let (lower, upper) = split(tree, at: node)
+            left[Int(node)] = lower
+            right[Int(node)] = upper
+            update(node)
+            return node
+        }
+        if isLess(node, tree) {
+            left[Int(tree)] = attach(node, to: left[Int(tree)])
+        } else {
+            right[Int(tree)] = attach(node, to: right[Int(tree)])
+        }
+        update(tree)
+        return tree
+    }
+
+    /// Removes `node` from the subtree rooted at `tree`; returns the new root.
+    fileprivate func detach(_ node: Int32, from tree: Int32) -> Int32 {
+        guard tree >= 0 else { return tree }
+        if tree == node {
+            return merge(left[Int(node)], right[Int(node)])
+        }
+        if isLess(node, tree) {
+            left[Int(tree)] = detach(node, from: left[Int(tree)])
+        } else {
+            right[Int(tree)] = detach(node, from: right[Int(tree)])
+        }
+        update(tree)
+        return tree
+    }
+
+    /// Splits `tree` into the nodes ordered before `pivot` and the rest.
+    fileprivate func split(_ tree: Int32, at pivot: Int32) -> (Int32, Int32) {
+        guard tree >= 0 else { return (-1, -1) }
+        if isLess(tree, pivot) {
+            let (lower, upper) = split(right[Int(tree)], at: pivot)
+            right[Int(tree)] = lower
+            update(tree)
+            return (tree, upper)
+        }
+        let (lower, upper) = split(left[Int(tree)], at: pivot)
+        left[Int(tree)] = upper
+        update(tree)
+        return (lower, tree)
+    }
+
+    /// Joins two trees where every node of `lower` is ordered before every node of `upper`.
+    fileprivate func merge(_ lower: Int32, _ upper: Int32) -> Int32 {
+        guard lower >= 0 else { return upper }
+        guard upper >= 0 else { return lower }
+        if priorities[Int(lower)] > priorities[Int(upper)] {
+            right[Int(lower)] = merge(right[Int(lower)], upper)
+            update(lower)
+            return lower
+        }
+        left[Int(upper)] = merge(lower, left[Int(upper)])
+        update(upper)
+        return upper
+    }
+}
@@ -0,0 +1,228 @@
+//
+//  GeoBatch.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+import Accelerate
+
+/// Batch versions of `NMAGeoCoordinates.distance(to:)` and `heading(to:)`.
+///
+/// Coordinates are passed as struct-of-arrays latitude/longitude buffers (degrees),
+/// so one origin can be measured against hundreds of thousands of points without
+/// creating an `NMAGeoCoordinates` per point. The vector path runs on vDSP/vForce
+/// (NEON on device, SSE/AVX on the simulator); short inputs use the scalar path.
+enum GeoBatch {
+
+    /// Mean Earth radius in meters used by the Haversine formula.
+    static let earthRadius: Double = 6371000
+    static let degreesToRadians: Double = Double.pi / 180
+    static let radiansToDegrees: Double = 180 / Double.pi
+
+    /// Inputs shorter than this are not worth the vForce call overhead.
+    static let vectorThreshold = 16
+    /// Points processed per vector pass, sized so the scratch buffers stay in L1/L2.
+    fileprivate static let chunkSize = 1024
+
+    // MARK: Scalar
+
+    /// Haversine distance in meters, same formula as `NMAGeoCoordinates.distance(to:)`.
+    static func distance(fromLatitude lat1: Double, longitude lon1: Double, toLatitude lat2: Double, longitude lon2: Double) -> Double {
+        let phi1 = lat1 * degreesToRadians
+        let phi2 = lat2 * degreesToRadians
+        let sinHalfDPhi = sin((phi2 - phi1) / 2)
+        let sinHalfDLambda = sin((lon2 - lon1) * degreesToRadians / 2)
+        let a = sinHalfDPhi * sinHalfDPhi + cos(phi1) * cos(phi2) * sinHalfDLambda * sinHalfDLambda
+        return 2 * earthRadius * asin(sqrt(min(1, max(0, a))))
+    }
+
+    /// Initial great-circle heading in degrees, 0 = north, increasing clockwise.
+    static func heading(fromLatitude lat1: Double, longitude lon1: Double, toLatitude lat2: Double, longitude lon2: Double) -> Double {
+        let phi1 = lat1 * degreesToRadians
+        let phi2 = lat2 * degreesToRadians
+        let dLambda = (lon2 - lon1) * degreesToRadians
+        let y = sin(dLambda) * cos(phi2)
+        let x = cos(phi1) * sin(phi2) - sin(phi1) * cos(phi2) * cos(dLambda)
+        let heading = atan2(y, x) * radiansToDegrees
+        return heading < 0 ? heading + 360 : heading
+    }
+
+    // MARK: Batch
+
+    /// Writes the distance in meters from the origin to every point into `result`.
+    static func distances(fromLatitude latitude: Double, longitude: Double,
+                          latitudes: UnsafeBufferPointer<Double>, longitudes: UnsafeBufferPointer<Double>,
+                          into result: UnsafeMutableBufferPointer<Double>) {
+        precondition(latitudes.count == longitudes.count && result.count >= latitudes.count, "GeoBatch: buffer size mismatch")
+        let count = latitudes.count
+        guard let lats = latitudes.baseAddress, let lons = longitudes.baseAddress, let out = result.baseAddress else { return }
+
+        if count < vectorThreshold {
+            for i in 0..<count {
+                out[i] = distance(fromLatitude: latitude, longitude: longitude, toLatitude: lats[i], longitude: lons[i])
+            }
+            return
+        }
+
+        let phi1 = latitude * degreesToRadians
+        let lambda1 = longitude * degreesToRadians
+        var cosPhi1 = cos(phi1)
+        var halfScale = degreesToRadians / 2
+        var fullScale = degreesToRadians
+        var minusHalfPhi1 = -phi1 / 2
+        var minusHalfLambda1 = -lambda1 / 2
+        var twoRadius = 2 * earthRadius
+        var zero: Double = 0
+        var one: Double = 1
+
+        var scratch = [Double](repeating: 0, count: 4 * chunkSize)
+        scratch.withUnsafeMutableBufferPointer { buffer in
+            let phi2 = buffer.baseAddress!
+            let cosPhi2 = phi2 + chunkSize
+            let sinLat = cosPhi2 + chunkSize
+            let sinLon = sinLat + chunkSize
+
+            var offset = 0
+            while offset < count {
+                let n = min(chunkSize, count - offset)
+                var n32 = Int32(n)
+                let length = vDSP_Length(n)
+                let lat = lats + offset
+                let lon = lons + offset
+                let dst = out + offset
+
+                // cos(phi2)
+                vDSP_vsmulD(lat, 1, &fullScale, phi2, 1, length)
+                vvcos(cosPhi2, phi2, &n32)
+                // sin^2(dPhi / 2)
+                vDSP_vsmsaD(lat, 1, &halfScale, &minusHalfPhi1, sinLat, 1, length)
+                vvsin(sinLat, sinLat, &n32)
+                vDSP_vsqD(sinLat, 1, sinLat, 1, length)
+                // sin^2(dLambda / 2)
+                vDSP_vsmsaD(lon, 1, &halfScale, &minusHalfLambda1, sinLon, 1, length)
+                vvsin(sinLon, sinLon, &n32)
+                vDSP_vsqD(sinLon, 1, sinLon, 1, length)
+                // a = sin^2(dPhi / 2) + cos(phi1) * cos(phi2) * sin^2(dLambda / 2)
+                vDSP_vmulD(cosPhi2, 1, sinLon, 1, sinLon, 1, length)
+                vDSP_vsmaD(sinLon, 1, &cosPhi1, sinLat, 1, dst, 1, length)
+                vDSP_vclipD(dst, 1, &zero, &one, dst, 1, length)
+                // d = 2R * asin(sqrt(a))
+                vvsqrt(dst, dst, &n32)
+                vvasin(dst, dst, &n32)
+                vDSP_vsmulD(dst, 1, &twoRadius, dst, 1, length)
+
+                offset += n
+            }
+        }
+    }
+
+    /// Writes the initial heading in degrees from the origin to every point into `result`.
+    static func headings(fromLatitude latitude: Double, longitude: Double,
+                         latitudes: UnsafeBufferPointer<Double>, longitudes: UnsafeBufferPointer<Double>,
+                         into result: UnsafeMutableBufferPointer<Double>) {
+        precondition(latitudes.count == longitudes.count && result.count >= latitudes.count, "GeoBatch: buffer size mismatch")
+        let count = latitudes.count
+        guard let lats = latitudes.baseAddress, let lons = longitudes.baseAddress, let out = result.baseAddress else { return }
+
+        if count < vectorThreshold {
+            for i in 0..<count {
+                out[i] = heading(fromLatitude: latitude, longitude: longitude, toLatitude: lats[i], longitude: lons[i])
+            }
+            return
+        }
+
+        let phi1 = latitude * degreesToRadians
+        var cosPhi1 = cos(phi1)
+        var minusSinPhi1 = -sin(phi1)
+        var scale = degreesToRadians
+        var minusLambda1 = -longitude * degreesToRadians
+        var toDegrees = radiansToDegrees
+
+        var scratch = [Double](repeating: 0, count: 6 * chunkSize)
+        scratch.withUnsafeMutableBufferPointer { buffer in
+            let angle = buffer.baseAddress!
+            let sinPhi2 = angle + chunkSize
+            let cosPhi2 = sinPhi2 + chunkSize
+            let sinDLambda = cosPhi2 + chunkSize
+            let cosDLambda = sinDLambda + chunkSize
+            let x = cosDLambda + chunkSize
+
+            var offset = 0
+            while offset < count {
+                let n = min(chunkSize, count - offset)
+                var n32 = Int32(n)
+                let length = vDSP_Length(n)
+                let dst = out + offset
+
+                vDSP_vsmulD(lats + offset, 1, &scale, angle, 1, length)
+                vvsincos(sinPhi2, cosPhi2, angle, &n32)
+                vDSP_vsmsaD(lons + offset, 1, &scale, &minusLambda1, angle, 1, length)
+                vvsincos(sinDLambda, cosDLambda, angle, &n32)
+                // y = sin(dLambda) * cos(phi2), stored in sinDLambda
+                vDSP_vmulD(sinDLambda, 1, cosPhi2, 1, sinDLambda, 1, length)
+                // x = cos(phi1) * sin(phi2) - sin(phi1) * cos(phi2) * cos(dLambda)
+                vDSP_vmulD(cosPhi2, 1, cosDLambda, 1, cosDLambda, 1, length)
+                vDSP_vsmulD(sinPhi2, 1, &cosPhi1, x, 1, length)
+                vDSP_vsmaD(cosDLambda, 1, &minusSinPhi1, x, 1, x, 1, length)
+                vvatan2(dst, sinDLambda, x, &n32)
+                vDSP_vsmulD(dst, 1, &toDegrees, dst, 1, length)
+                for i in 0..<n {
+                    let heading = dst[i]
+                    dst[i] = heading < 0 ? heading + 360 : heading
+                }
+
+                offset += n
+            }
+        }
+    }
+
+    // MARK: Parallel split
+
+    /// Splits `0..<count` into ranges of at least `minimumChunk` elements (rounded up to
+    /// a multiple of `alignment`) and runs them on the GCD worker pool. Small inputs run
+    /// inline on the calling thread.
+    static func concurrentChunks(count: Int, minimumChunk: Int = 65_536, alignment: Int = 64, body: (Range<Int>) -> Void) {
+        guard count > 0 else { return }
+        let workers = ProcessInfo.processInfo.activeProcessorCount
+        var chunk = max(minimumChunk, (count + workers - 1) / workers)
+        chunk = (chunk + alignment - 1) / alignment * alignment
+        let chunks = (count + chunk - 1) / chunk
+        if chunks == 1 {
+            body(0..<count)
+            return
+        }
+        DispatchQueue.concurrentPerform(iterations: chunks) { index in
+            let start = index * chunk
+            body(start..<min(start + chunk, count))
+        }
+    }
+
+    // MARK: Array convenience
+
+    static func distances(from origin: NMAGeoCoordinates, latitudes: [Double], longitudes: [Double]) -> [Double] {
+        var result = [Double](repeating: 0, count: latitudes.count)
+        latitudes.withUnsafeBufferPointer { lats in
+            longitudes.withUnsafeBufferPointer { lons in
+                result.withUnsafeMutableBufferPointer { out in
+                    distances(fromLatitude: origin.latitude, longitude: origin.longitude, latitudes: lats, longitudes: lons, into: out)
+                }
+            }
+        }
+        return result
+    }
+
+    static func headings(from origin: NMAGeoCoordinates, latitudes: [Double], longitudes: [Double]) -> [Double] {
+        var result = [Double](repeating: 0, count: latitudes.count)
+        latitudes.withUnsafeBufferPointer { lats in
+            longitudes.withUnsafeBufferPointer { lons in
+                result.withUnsafeMutableBufferPointer { out in
+                    headings(fromLatitude: origin.latitude, longitude: origin.longitude, latitudes: lats, longitudes: lons, into: out)
+                }
+            }
+        }
+        return result
+    }
+}
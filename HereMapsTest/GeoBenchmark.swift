@@ -0,0 +1,583 @@
+//
+//  GeoBenchmark.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+#if DEBUG
+
+import UIKit
+
+/// Debug-only timing helpers for the batch geometry code.
+///
+/// There is no test target, so these are run by hand from the debugger, e.g.
+/// `po GeoBenchmark.batchDistance()`. Build in Release (-Owholemodule) for meaningful numbers.
+enum GeoBenchmark {
+
+    static func measure(_ block: () -> Void) -> TimeInterval {
+        let start = CFAbsoluteTimeGetCurrent()
+        block()
+        return CFAbsoluteTimeGetCurrent() - start
+    }
+
+    static func randomCoordinates(count: Int, latitudeRange: ClosedRange<Double> = -85...85,
+                                  longitudeRange: ClosedRange<Double> = -180...180) -> (latitudes: [Double], longitudes: [Double]) {
+        var latitudes = [Double](repeating: 0, count: count)
+        var longitudes = [Double](repeating: 0, count: count)
+        for i in 0..<count {
+            latitudes[i] = latitudeRange.lowerBound + drand48() * (latitudeRange.upperBound - latitudeRange.lowerBound)
+            longitudes[i] = longitudeRange.lowerBound + drand48() * (longitudeRange.upperBound - longitudeRange.lowerBound)
+        }
+        return (latitudes, longitudes)
+    }
+
+    // MARK: GeoBatch
+
+    /// Compares `GeoBatch.distances` and `headings` with per-object `NMAGeoCoordinates` calls.
+    @discardableResult
+    static func batchDistance(count: Int = 500_000) -> String {
+        let origin = NMAGeoCoordinates(latitude: 40.728333, longitude: -73.994167)
+        let points = randomCoordinates(count: count)
+
+        var perObject = [Double](repeating: 0, count: count)
+        let perObjectTime = measure {
+            for i in 0..<count {
+                let coordinates = NMAGeoCoordinates(latitude: points.latitudes[i], longitude: points.longitudes[i])
+                perObject[i] = origin.distance(to: coordinates)
+            }
+        }
+
+        var batch = [Double]()
+        let batchTime = measure {
+            batch = GeoBatch.distances(from: origin, latitudes: points.latitudes, longitudes: points.longitudes)
+        }
+        var headings = [Double]()
+        let headingTime = measure {
+            headings = GeoBatch.headings(from: origin, latitudes: points.latitudes, longitudes: points.longitudes)
+        }
+
+        var maxDistanceError: Double = 0
+        var maxHeadingError: Double = 0
+        for i in 0..<count {
+            let scalar = GeoBatch.distance(fromLatitude: origin.latitude, longitude: origin.longitude,
+                                           toLatitude: points.latitudes[i], longitude: points.longitudes[i])
+            maxDistanceError = max(maxDistanceError, abs(batch[i] - scalar))
+            let heading = GeoBatch.heading(fromLatitude: origin.latitude, longitude: origin.longitude,
+                                           toLatitude: points.latitudes[i], longitude: points.longitudes[i])
+            let delta = abs(headings[i] - heading)
+            maxHeadingError = max(maxHeadingError, min(delta, 360 - delta))
+        }
+        var maxSdkDeviation: Double = 0
+        for i in 0..<count {
+            maxSdkDeviation = max(maxSdkDeviation, abs(batch[i] - perObject[i]) / max(perObject[i], 1))
+        }
+
+        return String(format: "%d points: NMAGeoCoordinates %.1f ms, batch distance %.1f ms, batch heading %.1f ms; " +
+                              "max error vs scalar %.2e m / %.2e deg; max relative deviation vs SDK %.2e",
+                      count, perObjectTime * 1000, batchTime * 1000, headingTime * 1000,
+                      maxDistanceError, maxHeadingError, maxSdkDeviation)
+    }
+
+    // MARK: MercatorProjection
+
+    /// Compares batch projection with `NMAMapView.point(from:)` on points around the current view.
+    @discardableResult
+    static func projection(mapView: NMAMapView, count: Int = 100_000) -> String {
+        guard let projection = MercatorProjection(mapView: mapView) else { return "map view has no camera yet" }
+        let box = GeoBox(mapView.boundingBox)
+        let points = randomCoordinates(count: count, latitudeRange: box.south...box.north,
+                                       longitudeRange: box.west...(box.west + box.longitudeSpan))
+        let buffer = GeoCoordinateBuffer(latitudes: points.latitudes, longitudes: points.longitudes)
+
+        var perPoint = [CGPoint]()
+        let perPointTime = measure {
+            for i in 0..<count {
+                perPoint.append(mapView.point(from: buffer.geoCoordinates(at: i)))
+            }
+        }
+        var batch = [CGPoint]()
+        let batchTime = measure {
+            batch = projection.points(for: buffer)
+        }
+
+        var maxError: CGFloat = 0
+        for i in 0..<count {
+            maxError = max(maxError, hypot(batch[i].x - perPoint[i].x, batch[i].y - perPoint[i].y))
+        }
+        return String(format: "%d points: point(from:) %.1f ms, batch %.1f ms, max deviation %.3f pt",
+                      count, perPointTime * 1000, batchTime * 1000, Double(maxError))
+    }
+
+    // MARK: GeoBox
+
+    /// Bulk point containment against `NMAGeoBoundingBox.contains(_:)` for a date line
+    /// crossing box, with the points where bulk and scalar answers differ and the number of
+    /// failed edge cases (edges, date line, full globe).
+    @discardableResult
+    static func boxContainment(count: Int = 1_000_000, sdkQueries: Int = 10_000) -> String {
+        let box = GeoBox(north: 60, south: -60, west: 170, east: -170)
+        var points = randomCoordinates(count: count, latitudeRange: -90...90)
+        // Some points exactly on the north and south edges.
+        for i in stride(from: 0, to: count, by: 100) {
+            points.latitudes[i] = i % 200 == 0 ? box.north : box.south
+        }
+
+        var mask = GeoBitmask(count: 0)
+        let bulkTime = points.latitudes.withUnsafeBufferPointer { lats in
+            points.longitudes.withUnsafeBufferPointer { lons in
+                measure {
+                    mask = box.containment(latitudes: lats, longitudes: lons)
+                }
+            }
+        }
+        var mismatches = 0
+        for i in 0..<count where mask[i] != box.contains(latitude: points.latitudes[i], longitude: points.longitudes[i]) {
+            mismatches += 1
+        }
+        let boundingBox = box.boundingBox
+        let sdkCount = min(sdkQueries, count)
+        let sdkTime = measure {
+            for i in 0..<sdkCount {
+                _ = boundingBox.contains(NMAGeoCoordinates(latitude: points.latitudes[i], longitude: points.longitudes[i]))
+            }
+        }
+
+        let globe = GeoBox(north: 90, south: -90, west: -180, east: 180)
+        let checks = [
+            box.contains(latitude: box.north, longitude: 180),
+            !box.contains(latitude: 0, longitude: 0),
+            box.contains(GeoBox(north: 10, south: 0, west: 175, east: -175)),
+            !box.contains(GeoBox(north: 10, south: 0, west: 160, east: 175)),
+            box.intersects(GeoBox(north: 10, south: 0, west: 160, east: 175)),
+            globe.contains(box),
+            globe.contains(GeoBox(north: 10, south: 0, west: -10, east: 10)),
+            globe.contains(latitude: 0, longitude: 180),
+        ]
+        let failed = checks.filter { !$0 }.count
+        return String(format: "%d points: bulk %.1f ms (%d mismatches vs scalar), SDK %.3f us per point; %d of %d edge cases failed",
+                      count, bulkTime * 1000, mismatches, sdkTime * 1e6 / Double(max(sdkCount, 1)), failed, checks.count)
+    }
+
+    // MARK: GeoDistanceAccuracy
+
+    /// Throughput of each distance tier and its deviation from the geodesic result.
+    @discardableResult
+    static func distanceTiers(count: Int = 500_000, spreadDegrees: Double = 1) -> String {
+        let origin = NMAGeoCoordinates(latitude: 52.53, longitude: 13.38)
+        let points = randomCoordinates(count: count,
+                                       latitudeRange: (origin.latitude - spreadDegrees)...(origin.latitude + spreadDegrees),
+                                       longitudeRange: (origin.longitude - spreadDegrees)...(origin.longitude + spreadDegrees))
+        var results = [[Double]]()
+        var lines = [String]()
+        for (name, accuracy) in [("equirectangular", GeoDistanceAccuracy.equirectangular),
+                                 ("haversine", .haversine), ("geodesic", .geodesic)] {
+            var distances = [Double]()
+            let time = measure {
+                distances = GeoBatch.distances(from: origin, latitudes: points.latitudes, longitudes: points.longitudes, accuracy: accuracy)
+            }
+            results.append(distances)
+            lines.append(name + String(format: " %.1f Mpts/s", Double(count) / time / 1e6))
+        }
+        for (tier, name) in ["equirectangular", "haversine"].enumerated() {
+            var maxRelative: Double = 0
+            for i in 0..<count where results[2][i] > 0 {
+                maxRelative = max(maxRelative, abs(results[tier][i] - results[2][i]) / results[2][i])
+            }
+            lines.append(name + String(format: " max relative deviation from geodesic %.2e", maxRelative))
+        }
+        return lines.joined(separator: "; ")
+    }
+
+    // MARK: MarkerClusterIndex
+
+    /// Bulk build time and per-viewport query time of the cluster index over a city-sized view.
+    @discardableResult
+    static func clustering(count: Int = 200_000, zoomLevel: Float = 12) -> String {
+        let points = randomCoordinates(count: count)
+        var markers = [NMAMapMarker]()
+        markers.reserveCapacity(count)
+        for i in 0..<count {
+            markers.append(NMAMapMarker(geoCoordinates: NMAGeoCoordinates(latitude: points.latitudes[i], longitude: points.longitudes[i])))
+        }
+
+        var index: MarkerClusterIndex!
+        let buildTime = measure {
+            index = MarkerClusterIndex(markers: markers)
+        }
+        let viewport = GeoBox(north: 52.6, south: 52.4, west: 13.2, east: 13.6)
+        let queries = 1000
+        var items = 0
+        let queryTime = measure {
+            for _ in 0..<queries {
+                items = index.items(in: viewport, zoomLevel: zoomLevel).count
+            }
+        }
+        let world = GeoBox(north: 85, south: -85, west: -180, east: 180)
+        var worldItems = 0
+        let worldTime = measure {
+            worldItems = index.items(in: world, zoomLevel: 2).count
+        }
+        return String(format: "%d markers: build %.1f ms, viewport query %.3f ms (%d items), world at zoom 2 %.3f ms (%d items)",
+                      count, buildTime * 1000, queryTime * 1000 / Double(queries), items, worldTime * 1000, worldItems)
+    }
+
+    // MARK: MapHitTestIndex
+
+    /// Index build and per-tap pick time for markers spread around one city, at 10k, 100k and 1M objects.
+    @discardableResult
+    static func hitTesting(counts: [Int] = [10_000, 100_000, 1_000_000], zoomLevel: Double = 14) -> String {
+        let center = (latitude: 52.52, longitude: 13.40)
+        let scale = 256 * pow(2, zoomLevel)
+        let centerX = MercatorProjection.mercatorX(longitude: center.longitude)
+        let centerY = MercatorProjection.mercatorY(latitude: center.latitude)
+        guard let projection = MercatorProjection(a: scale, b: 0, c: 0, d: scale, tx: 160 - scale * centerX,
+                                                  ty: 284 - scale * centerY, centerX: centerX) else { return "invalid projection" }
+        var lines = [String]()
+        for count in counts {
+            let points = randomCoordinates(count: count, latitudeRange: (center.latitude - 0.5)...(center.latitude + 0.5),
+                                           longitudeRange: (center.longitude - 0.5)...(center.longitude + 0.5))
+            let index = MapHitTestIndex()
+            var markers = [NMAMapMarker]()
+            markers.reserveCapacity(count)
+            for i in 0..<count {
+                markers.append(NMAMapMarker(geoCoordinates: NMAGeoCoordinates(latitude: points.latitudes[i], longitude: points.longitudes[i])))
+            }
+            let buildTime = measure {
+                markers.forEach { index.add($0) }
+            }
+            let taps = 1000
+            var hits = 0
+            let pickTime = measure {
+                for _ in 0..<taps {
+                    let point = CGPoint(x: drand48() * 320, y: drand48() * 568)
+                    hits += index.objects(at: point, projection: projection, tolerance: 4).count
+                }
+            }
+            lines.append(String(format: "%d objects: build %.0f ms, pick %.3f ms (%.1f hits)",
+                                count, buildTime * 1000, pickTime * 1000 / Double(taps), Double(hits) / Double(taps)))
+        }
+        return lines.joined(separator: "; ")
+    }
+
+    // MARK: PolylineSegmentIndex
+
+    /// Nearest-vertex lookups on a random-walk track: `NMAMapPolyline.indexOfNearestVertex(to:)` vs the segment index.
+    @discardableResult
+    static func segmentIndex(vertexCount: Int = 100_000, queries: Int = 1000) -> String {
+        var track = GeoCoordinateBuffer(capacity: vertexCount)
+        var latitude = 52.52, longitude = 13.40
+        for _ in 0..<vertexCount {
+            latitude += (drand48() - 0.5) * 0.001
+            longitude += (drand48() - 0.5) * 0.001
+            track.append(latitude: latitude, longitude: longitude)
+        }
+        let polyline = NMAMapPolyline(buffer: track)
+        var index: PolylineSegmentIndex!
+        let buildTime = measure {
+            index = PolylineSegmentIndex(vertices: track)
+        }
+        let targets = (0..<queries).map { _ -> NMAGeoCoordinates in
+            let vertex = Int(drand48() * Double(vertexCount - 1))
+            return NMAGeoCoordinates(latitude: track.latitudes[vertex] + 0.0001, longitude: track.longitudes[vertex])
+        }
+
+        var mismatches = 0
+        var sdk = [Int]()
+        let sdkTime = measure {
+            sdk = targets.map { polyline.indexOfNearestVertex(to: $0) }
+        }
+        var indexed = [Int]()
+        let indexTime = measure {
+            indexed = targets.map { index.nearestVertex(to: $0) ?? -1 }
+        }
+        var snapped = 0
+        let snapTime = measure {
+            snapped = targets.flatMap { index.nearestPoint(to: $0) }.count
+        }
+        for i in 0..<queries where sdk[i] != indexed[i] {
+            mismatches += 1
+        }
+        return String(format: "%d vertices: build %.1f ms; nearest vertex SDK %.3f ms, index %.3f ms (%d mismatches); nearest point %.3f ms (%d)",
+                      vertexCount, buildTime * 1000, sdkTime * 1000 / Double(queries), indexTime * 1000 / Double(queries),
+                      mismatches, snapTime * 1000 / Double(queries), snapped)
+    }
+
+    // MARK: PolygonContainmentIndex
+
+    /// Single and batch point-in-polygon on a star-shaped polygon: `NMAMapPolygon.contains(_:)` vs the slab index.
+    @discardableResult
+    static func polygonContainment(vertexCount: Int = 20_000, pointCount: Int = 1_000_000, sdkQueries: Int = 1000) -> String {
+        var ring = GeoCoordinateBuffer(capacity: vertexCount)
+        for i in 0..<vertexCount {
+            let angle = 2 * Double.pi * Double(i) / Double(vertexCount)
+            let radius = 0.5 + 0.3 * drand48()
+            ring.append(latitude: 50 + radius * sin(angle), longitude: 10 + radius * cos(angle))
+        }
+        let polygon = NMAMapPolygon(buffer: ring)
+        let index = PolygonContainmentIndex(vertices: ring)
+        let points = randomCoordinates(count: pointCount, latitudeRange: 49...51, longitudeRange: 9...11)
+
+        let sdkCount = min(sdkQueries, pointCount)
+        var sdk = [Bool]()
+        let sdkTime = measure {
+            sdk = (0..<sdkCount).map { polygon.contains(NMAGeoCoordinates(latitude: points.latitudes[$0], longitude: points.longitudes[$0])) }
+        }
+        let buildTime = measure {
+            _ = index.contains(latitude: 50, longitude: 10)
+        }
+        var mask = GeoBitmask(count: 0)
+        let batchTime = measure {
+            mask = index.containment(of: GeoCoordinateBuffer(latitudes: points.latitudes, longitudes: points.longitudes))
+        }
+        var mismatches = 0
+        for i in 0..<sdkCount where sdk[i] != mask[i] {
+            mismatches += 1
+        }
+        return String(format: "%d vertices: SDK contains %.3f ms/point; slab build %.1f ms; batch %d points %.1f ms (%d inside, %d of %d mismatches vs SDK)",
+                      vertexCount, sdkTime * 1000 / Double(max(sdkCount, 1)), buildTime * 1000, pointCount, batchTime * 1000,
+                      mask.nonzeroBitCount, mismatches, sdkCount)
+    }
+
+    // MARK: PolygonTriangulation
+
+    /// Interactive drawing: vertices inserted one at a time into a star-shaped ring, then
+    /// removed again, against triangulating the finished ring from scratch.
+    @discardableResult
+    static func triangulation(vertexCount: Int = 4000, edits: Int = 500) -> String {
+        var ring = GeoCoordinateBuffer(capacity: vertexCount)
+        for i in 0..<vertexCount {
+            let angle = 2 * Double.pi * Double(i) / Double(vertexCount)
+            let radius = 0.5 + 0.3 * drand48()
+            ring.append(latitude: 50 + radius * sin(angle), longitude: 10 + radius * cos(angle))
+        }
+        var triangulation = PolygonTriangulation()
+        let fullTime = measure {
+            triangulation = PolygonTriangulation(vertices: ring)
+        }
+        var local = 0
+        let insertTime = measure {
+            for _ in 0..<edits {
+                let index = 1 + Int(arc4random_uniform(UInt32(triangulation.count - 1)))
+                let a = triangulation.vertices.geoCoordinates(at: index - 1), b = triangulation.vertices.geoCoordinates(at: index)
+                // Midpoint pushed slightly outwards, so it isn't collinear with its neighbors.
+                let latitude = 50 + ((a.latitude + b.latitude) / 2 - 50) * 1.01
+                let longitude = 10 + ((a.longitude + b.longitude) / 2 - 10) * 1.01
+                triangulation.insert(latitude: latitude, longitude: longitude, at: index)
+                local += triangulation.lastEditWasLocal ? 1 : 0
+            }
+        }
+        let removeTime = measure {
+            for _ in 0..<edits {
+                triangulation.remove(at: Int(arc4random_uniform(UInt32(triangulation.count))))
+                local += triangulation.lastEditWasLocal ? 1 : 0
+            }
+        }
+        return String(format: "%d vertices: full %.1f ms; insert %.3f ms, remove %.3f ms per edit (%d of %d local); %d triangles",
+                      vertexCount, fullTime * 1000, insertTime * 1000 / Double(edits), removeTime * 1000 / Double(edits),
+                      local, 2 * edits, triangulation.triangleCount)
+    }
+
+    // MARK: CircleTessellation
+
+    /// Outlines for many geofence circles from the shared templates, against computing every
+    /// vertex with sin/cos.
+    @discardableResult
+    static func circleTessellation(circleCount: Int = 10_000, zoomLevel: Float = 14) -> String {
+        let points = randomCoordinates(count: circleCount, latitudeRange: 40...60, longitudeRange: -10...30)
+        let centers = GeoCoordinateBuffer(latitudes: points.latitudes, longitudes: points.longitudes)
+        let radii = (0..<circleCount).map { _ in 20 + drand48() * 2000 }
+        let tessellation = CircleTessellation()
+        var outlines = [GeoCoordinateBuffer]()
+        let templateTime = measure {
+            outlines = tessellation.vertices(centers: centers, radii: radii, zoomLevel: zoomLevel)
+        }
+        let vertexCount = outlines.reduce(0) { $0 + $1.count }
+        let directTime = measure {
+            for (i, outline) in outlines.enumerated() {
+                let scale = radii[i] / GeoBatch.earthRadius * GeoBatch.radiansToDegrees
+                var buffer = GeoCoordinateBuffer(capacity: outline.count)
+                for k in 0..<outline.count {
+                    let angle = 2 * Double.pi * Double(k) / Double(outline.count)
+                    buffer.append(latitude: points.latitudes[i] + scale * sin(angle),
+                                  longitude: points.longitudes[i] + scale * cos(angle) / cos(points.latitudes[i] * GeoBatch.degreesToRadians))
+                }
+            }
+        }
+        return String(format: "%d circles, %d vertices at zoom %.0f: templates %.1f ms, direct sin/cos %.1f ms",
+                      circleCount, vertexCount, zoomLevel, templateTime * 1000, directTime * 1000)
+    }
+
+    // MARK: GeoGapBuffer
+
+    /// Inserts and removes around a wandering cursor in a long track: flat arrays vs the gap buffer.
+    @discardableResult
+    static func gapBuffer(vertexCount: Int = 100_000, edits: Int = 10_000) -> String {
+        let points = randomCoordinates(count: vertexCount, latitudeRange: 50...51, longitudeRange: 10...11)
+        var flat = GeoCoordinateBuffer(latitudes: points.latitudes, longitudes: points.longitudes)
+        var gapped = GeoGapBuffer(flat)
+        var cursors = [Int](repeating: 0, count: edits)
+        var cursor = vertexCount / 2
+        for i in 0..<edits {
+            cursor = min(max(cursor + Int(arc4random_uniform(9)) - 4, 1), vertexCount - 1)
+            cursors[i] = cursor
+        }
+        let flatTime = measure {
+            for (i, index) in cursors.enumerated() {
+                if i % 2 == 0 {
+                    flat.insert(latitude: 50.5, longitude: 10.5, at: index)
+                } else {
+                    flat.remove(at: index)
+                }
+            }
+        }
+        let gapTime = measure {
+            for (i, index) in cursors.enumerated() {
+                if i % 2 == 0 {
+                    gapped.insert(latitude: 50.5, longitude: 10.5, at: index)
+                } else {
+                    gapped.remove(at: index)
+                }
+            }
+        }
+        var sum = 0.0
+        let readTime = measure {
+            gapped.withUnsafeView { view in
+                for run in view.runs {
+                    for i in run {
+                        sum += view.latitudes[i]
+                    }
+                }
+            }
+        }
+        return String(format: "%d vertices, %d edits: arrays %.1f ms, gap buffer %.1f ms; full read %.2f ms (%.0f)",
+                      vertexCount, edits, flatTime * 1000, gapTime * 1000, readTime * 1000, sum)
+    }
+
+    // MARK: DrawOrderIndex
+
+    /// zIndex changes in a large scene: re-sorting the draw list per change vs the order index.
+    @discardableResult
+    static func drawOrder(objectCount: Int = 100_000, changes: Int = 1000, resorts: Int = 10) -> String {
+        var markers = [NMAMapMarker]()
+        markers.reserveCapacity(objectCount)
+        for _ in 0..<objectCount {
+            let marker = NMAMapMarker(geoCoordinates: NMAGeoCoordinates(latitude: 50, longitude: 10))
+            marker.zIndex = UInt(arc4random_uniform(64))
+            markers.append(marker)
+        }
+        let index = DrawOrderIndex()
+        let loadTime = measure {
+            index.load(markers)
+        }
+        let resortTime = measure {
+            for _ in 0..<resorts {
+                _ = markers.enumerated().sorted { $0.element.zIndex != $1.element.zIndex ? $0.element.zIndex < $1.element.zIndex : $0.offset < $1.offset }
+            }
+        }
+        let changeTime = measure {
+            for _ in 0..<changes {
+                let marker = markers[Int(arc4random_uniform(UInt32(objectCount)))]
+                index.setZIndex(UInt(arc4random_uniform(64)), of: marker)
+            }
+        }
+        return String(format: "%d objects: bulk load %.1f ms; full re-sort %.1f ms per change; index %.4f ms per change",
+                      objectCount, loadTime * 1000, resortTime * 1000 / Double(resorts), changeTime * 1000 / Double(changes))
+    }
+
+    // MARK: IconAtlas
+
+    /// Icons for many markers drawn from a few distinct pictures, each marker bringing its own
+    /// `UIImage` copy: how many bitmaps stay alive with the atlas.
+    @discardableResult
+    static func iconAtlas(markerCount: Int = 2000, distinctIcons: Int = 20) -> String {
+        let colors = (0..<distinctIcons).map { UIColor(hue: CGFloat($0) / CGFloat(distinctIcons), saturation: 1, brightness: 1, alpha: 1) }
+        var images = [UIImage]()
+        images.reserveCapacity(markerCount)
+        for i in 0..<markerCount {
+            UIGraphicsBeginImageContextWithOptions(CGSize(width: 48, height: 48), false, 2)
+            colors[i % distinctIcons].setFill()
+            UIBezierPath(ovalIn: CGRect(x: 4, y: 4, width: 40, height: 40)).fill()
+            images.append(UIGraphicsGetImageFromCurrentImageContext()!)
+            UIGraphicsEndImageContext()
+        }
+        let atlas = IconAtlas()
+        var shared = [UIImage]()
+        let time = measure {
+            shared = images.map { atlas.icon(for: $0) }
+        }
+        let distinct = Set(shared.map { ObjectIdentifier($0) }).count
+        return String(format: "%d marker images: %.3f ms per icon; %d distinct bitmaps kept on %d page(s)",
+                      markerCount, time * 1000 / Double(markerCount), distinct, atlas.pageCount)
+    }
+
+    // MARK: LabelCollisionGrid
+
+    /// Label placement for dense markers in a fixed viewport, and a re-placement after a small pan.
+    @discardableResult
+    static func labelCollision(labelCount: Int = 20_000) -> String {
+        let points = randomCoordinates(count: labelCount, latitudeRange: 49.9...50.1, longitudeRange: 9.85...10.15)
+        let grid = LabelCollisionGrid()
+        for i in 0..<labelCount {
+            let marker = NMAMapMarker(geoCoordinates: NMAGeoCoordinates(latitude: points.latitudes[i], longitude: points.longitudes[i]))
+            marker.title = "Label \(i)"
+            marker.zIndex = UInt(arc4random_uniform(4))
+            grid.add(marker)
+        }
+        // About zoom 13 on a 375 x 667 pt screen centered at (50, 10).
+        let scale = 256 * pow(2, 13.0)
+        let cx = MercatorProjection.mercatorX(longitude: 10), cy = MercatorProjection.mercatorY(latitude: 50)
+        let viewport = CGRect(x: 0, y: 0, width: 375, height: 667)
+        let projection = MercatorProjection(a: scale, b: 0, c: 0, d: scale, tx: 187.5 - scale * cx, ty: 333.5 - scale * cy, centerX: cx)!
+        let panned = MercatorProjection(a: scale, b: 0, c: 0, d: scale, tx: 190.5 - scale * cx, ty: 335.5 - scale * cy, centerX: cx)!
+        var first = LabelPlacementChange(shown: [], hidden: [])
+        let firstTime = measure {
+            first = grid.place(projection: projection, viewport: viewport)
+        }
+        var second = LabelPlacementChange(shown: [], hidden: [])
+        let panTime = measure {
+            second = grid.place(projection: panned, viewport: viewport)
+        }
+        return String(format: "%d labels: first frame %.2f ms (%d shown); 3 pt pan %.2f ms (%d shown, %d hidden)",
+                      labelCount, firstTime * 1000, first.shown.count, panTime * 1000, second.shown.count, second.hidden.count)
+    }
+
+    // MARK: TextLayoutCache
+
+    /// Bubble descriptions measured on every show vs looked up in the layout cache.
+    @discardableResult
+    static func textLayout(textCount: Int = 1000, shows: Int = 5) -> String {
+        let texts = (0..<textCount).map { "Marker \($0): a longer description that wraps over a couple of lines in the bubble" }
+        let font = UIFont.systemFont(ofSize: 14)
+        let width: CGFloat = 200
+        let cache = TextLayoutCache(capacity: 2 * textCount)
+        let uncachedTime = measure {
+            for _ in 0..<shows {
+                for text in texts {
+                    _ = (text as NSString).boundingRect(with: CGSize(width: width, height: .greatestFiniteMagnitude),
+                                                        options: [.usesLineFragmentOrigin, .usesFontLeading],
+                                                        attributes: [NSFontAttributeName: font], context: nil)
+                }
+            }
+        }
+        let firstTime = measure {
+            for text in texts {
+                _ = cache.layout(for: text, font: font, width: width)
+            }
+        }
+        let cachedTime = measure {
+            for _ in 0..<shows - 1 {
+                for text in texts {
+                    _ = cache.layout(for: text, font: font, width: width)
+                }
+            }
+        }
+        let perShow = Double(textCount)
+        return String(format: "%d texts: measuring %.4f ms per show; cache miss %.4f ms, hit %.4f ms",
+                      textCount, uncachedTime * 1000 / (perShow * Double(shows)), firstTime * 1000 / perShow,
+                      cachedTime * 1000 / (perShow * Double(shows - 1)))
+    }
+}
+
+#endif
@@ -0,0 +1,408 @@
+//
+//  GeoBox.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+import Accelerate
+
+/// Value-type counterpart of `NMAGeoBoundingBox` for bulk queries.
+///
+/// Follows the SDK convention: a box runs east from `west` to `east`, so `west > east`
+/// means it crosses the international date line, and west = -180, east = 180 covers
+/// the whole globe. Queries use the longitude offset from `west`, wrapped into
+/// [0, 360), which handles both cases without a per-element branch.
+struct GeoBox {
+
+    var north: Double
+    var south: Double
+    var west: Double
+    var east: Double
+
+    init(north: Double, south: Double, west: Double, east: Double) {
+        self.north = north
+        self.south = south
+        self.west = west
+        self.east = east
+    }
+
+    init(_ boundingBox: NMAGeoBoundingBox) {
+        self.init(north: boundingBox.topLeft.latitude, south: boundingBox.bottomRight.latitude,
+                  west: boundingBox.topLeft.longitude, east: boundingBox.bottomRight.longitude)
+    }
+
+    var boundingBox: NMAGeoBoundingBox {
+        return NMAGeoBoundingBox(topLeft: NMAGeoCoordinates(latitude: north, longitude: west),
+                                 bottomRight: NMAGeoCoordinates(latitude: south, longitude: east))
+    }
+
+    var crossesDateLine: Bool {
+        return west > east
+    }
+
+    /// Eastward extent in degrees, in [0, 360].
+    var longitudeSpan: Double {
+        return GeoBox.wrappedOffset(east - west)
+    }
+
+    var latitudeSpan: Double {
+        return north - south
+    }
+
+    func contains(latitude: Double, longitude: Double) -> Bool {
+        return latitude >= south && latitude <= north && GeoBox.wrappedOffset(longitude - west) <= longitudeSpan
+    }
+
+    /// True when `other` lies entirely inside this box.
+    func contains(_ other: GeoBox) -> Bool {
+        // A full-globe box holds every longitude range, wherever the other box starts.
+        return other.south >= south && other.north <= north
+            && (longitudeSpan >= 360 || GeoBox.wrappedOffset(other.west - west) + other.longitudeSpan <= longitudeSpan)
+    }
+
+    func intersects(_ other: GeoBox) -> Bool {
+        return other.south <= north && other.north >= south
+            && (GeoBox.wrappedOffset(other.west - west) <= longitudeSpan
+                || GeoBox.wrappedOffset(west - other.west) <= other.longitudeSpan)
+    }
+
+    /// Maps a longitude difference from (-360, 360) into [0, 360); compiles to a select.
+    @inline(__always)
+    static func wrappedOffset(_ delta: Double) -> Double {
+        return delta < 0 ? delta + 360 : delta
+    }
+}
+
+/// Result of a bulk query: one bit per input element.
+struct GeoBitmask {
+
+    fileprivate(set) var words: [UInt64]
+    let count: Int
+
+    init(count: Int) {
+        self.count = count
+        words = [UInt64](repeating: 0, count: (count + 63) / 64)
+    }
+
+    subscript(index: Int) -> Bool {
+        return words[index >> 6] & (1 << UInt64(index & 63)) != 0
+    }
+
+    var nonzeroBitCount: Int {
+        var total = 0
+        for word in words {
+            var remaining = word
+            while remaining != 0 {
+                remaining &= remaining - 1
+                total += 1
+            }
+        }
+        return total
+    }
+
+    /// Indices of the set bits in ascending order.
+    func indices() -> [Int] {
+        var result = [Int]()
+        for (wordIndex, word) in words.enumerated() {
+            var remaining = word
+            while remaining != 0 {
+                let bit = Int(ffsll(Int64(bitPattern: remaining))) - 1
+                result.append(wordIndex << 6 | bit)
+                remaining &= remaining - 1
+            }
+        }
+        return result
+    }
+
+    /// Fills the mask 64 elements at a time on the worker pool; `predicate(i)` is
+    /// evaluated for every index, so it must not have side effects.
+    mutating func fill(_ predicate: (Int) -> Bool) {
+        let count = self.count
+        guard count > 0 else { return }
+        words.withUnsafeMutableBufferPointer { buffer in
+            let words = buffer.baseAddress!
+            GeoBatch.concurrentChunks(count: count) { range in
+                var index = range.lowerBound
+                while index < range.upperBound {
+                    let end = min(index + 64, range.upperBound)
+                    var word: UInt64 = 0
+                    for i in index..<end {
+                        word |= (predicate(i) ? 1 : 0) << UInt64(i - index)
+                    }
+                    words[index >> 6] = word
+                    index = end
+                }
+            }
+        }
+    }
+}
+
+/// Struct-of-arrays storage for many boxes.
+struct GeoBoxBuffer {
+
+    fileprivate(set) var norths: [Double] = []
+    fileprivate(set) var souths: [Double] = []
+    fileprivate(set) var wests: [Double] = []
+    fileprivate(set) var easts: [Double] = []
+
+    init() {}
+
+    init(boxes: [GeoBox]) {
+        reserveCapacity(boxes.count)
+        for box in boxes {
+            append(box)
+        }
+    }
+
+    var count: Int {
+        return norths.count
+    }
+
+    subscript(index: Int) -> GeoBox {
+        return GeoBox(north: norths[index], south: souths[index], west: wests[index], east: easts[index])
+    }
+
+    mutating func reserveCapacity(_ capacity: Int) {
+        norths.reserveCapacity(capacity)
+        souths.reserveCapacity(capacity)
+        wests.reserveCapacity(capacity)
+        easts.reserveCapacity(capacity)
+    }
+
+    mutating func append(_ box: GeoBox) {
+        norths.append(box.north)
+        souths.append(box.south)
+        wests.append(box.west)
+        easts.append(box.east)
+    }
+}
+
+// MARK: Bulk queries
+
+extension GeoBox {
+
+    /// Which of the points lie inside this box.
+    func containment(latitudes: UnsafeBufferPointer<Double>, longitudes: UnsafeBufferPointer<Double>) -> GeoBitmask {
+        precondition(latitudes.count == longitudes.count, "GeoBox: latitude/longitude count mismatch")
+        var mask = GeoBitmask(count: latitudes.count)
+        guard let lats = latitudes.baseAddress, let lons = longitudes.baseAddress else { return mask }
+        // Same compares as `contains(latitude:longitude:)`, so edge points agree.
+        let north = self.north, south = self.south, west = self.west
+        let span = longitudeSpan
+        mask.fill { i in
+            let latitude = lats[i]
+            return latitude >= south && latitude <= north && GeoBox.wrappedOffset(lons[i] - west) <= span
+        }
+        return mask
+    }
+
+    func containment(of points: GeoCoordinateBuffer) -> GeoBitmask {
+        return points.withUnsafeBuffers { lats, lons, _ in
+            containment(latitudes: lats, longitudes: lons)
+        }
+    }
+
+    /// Which of the boxes intersect this box.
+    func intersections(with boxes: GeoBoxBuffer) -> GeoBitmask {
+        var mask = GeoBitmask(count: boxes.count)
+        let north = self.north, south = self.south, west = self.west
+        let span = longitudeSpan
+        boxes.norths.withUnsafeBufferPointer { norths in
+            boxes.souths.withUnsafeBufferPointer { souths in
+                boxes.wests.withUnsafeBufferPointer { wests in
+                    boxes.easts.withUnsafeBufferPointer { easts in
+                        mask.fill { i in
+                            let otherWest = wests[i]
+                            let otherSpan = GeoBox.wrappedOffset(easts[i] - otherWest)
+                            let latitudeOverlap = souths[i] <= north && norths[i] >= south
+                            let longitudeOverlap = GeoBox.wrappedOffset(otherWest - west) <= span
+                                || GeoBox.wrappedOffset(west - otherWest) <= otherSpan
+                            return latitudeOverlap && longitudeOverlap
+                        }
+                    }
+                }
+            }
+        }
+        return mask
+    }
+}
+
+extension GeoBoxBuffer {
+
+    /// Which of the boxes contain the point.
+    func boxesContaining(latitude: Double, longitude: Double) -> GeoBitmask {
+        var mask = GeoBitmask(count: count)
+        norths.withUnsafeBufferPointer { norths in
+            souths.withUnsafeBufferPointer { souths in
+                wests.withUnsafeBufferPointer { wests in
+                    easts.withUnsafeBufferPointer { easts in
+                        mask.fill { i in
+                            let west = wests[i]
+                            return latitude >= souths[i] && latitude <= norths[i]
+                                && GeoBox.wrappedOffset(longitude - west) <= GeoBox.wrappedOffset(easts[i] - west)
+                        }
+                    }
+                }
+            }
+        }
+        return mask
+    }
+}
+
+// MARK: Minimal enclosing box
+
+extension GeoBox {
+
+    /// Smallest box containing every point, or nil for an empty buffer. Parallel
+    /// counterpart of `NMAGeoBoundingBox(containingCoordinates:)`.
+    init?(containing points: GeoCoordinateBuffer) {
+        let extent = points.withUnsafeBuffers { lats, lons, _ -> GeoExtent in
+            GeoExtent.reduce(count: lats.count) { range in
+                var extent = GeoExtent()
+                extent.addPoints(latitudes: lats.baseAddress! + range.lowerBound,
+                                 longitudes: lons.baseAddress! + range.lowerBound, count: range.count)
+                return extent
+            }
+        }
+        guard let box = extent.box else { return nil }
+        self = box
+    }
+
+    /// Smallest box containing every box, or nil for an empty buffer. Parallel
+    /// counterpart of `NMAGeoBoundingBox(containingBoundingBoxes:)`.
+    init?(containing boxes: GeoBoxBuffer) {
+        let extent = boxes.norths.withUnsafeBufferPointer { norths in
+            boxes.souths.withUnsafeBufferPointer { souths in
+                boxes.wests.withUnsafeBufferPointer { wests in
+                    boxes.easts.withUnsafeBufferPointer { easts -> GeoExtent in
+                        GeoExtent.reduce(count: norths.count) { range in
+                            var extent = GeoExtent()
+                            let start = range.lowerBound
+                            extent.addBoxes(norths: norths.baseAddress! + start, souths: souths.baseAddress! + start,
+                                            wests: wests.baseAddress! + start, easts: easts.baseAddress! + start,
+                                            count: range.count)
+                            return extent
+                        }
+                    }
+                }
+            }
+        }
+        guard let box = extent.box else { return nil }
+        self = box
+    }
+}
+
+/// Partial result of the enclosing box reduction.
+///
+/// Longitude extents are tracked in two frames: as given, in [-180, 180], and shifted
+/// into [0, 360). Data straddling the antimeridian is compact in the shifted frame,
+/// data straddling Greenwich in the original one; the box uses the smaller span.
+fileprivate struct GeoExtent {
+
+    static let blockSize = 4096
+
+    var south = Double.infinity
+    var north = -Double.infinity
+    var westA = Double.infinity
+    var eastA = -Double.infinity
+    var westB = Double.infinity
+    var eastB = -Double.infinity
+
+    mutating func merge(_ other: GeoExtent) {
+        south = min(south, other.south)
+        north = max(north, other.north)
+        westA = min(westA, other.westA)
+        eastA = max(eastA, other.eastA)
+        westB = min(westB, other.westB)
+        eastB = max(eastB, other.eastB)
+    }
+
+    var box: GeoBox? {
+        guard south <= north else { return nil }
+        let spanA = eastA - westA
+        let spanB = eastB - westB
+        if min(spanA, spanB) >= 360 {
+            return GeoBox(north: north, south: south, west: -180, east: 180)
+        }
+        let west = spanB < spanA ? westB : westA
+        let east = spanB < spanA ? eastB : eastA
+        // West into [-180, 180), east into (-180, 180].
+        return GeoBox(north: north, south: south,
+                      west: west >= 180 ? west - 360 : west,
+                      east: east > 180 ? east - 360 : east)
+    }
+
+    /// Runs `partial` over chunks on the worker pool and merges the results.
+    static func reduce(count: Int, _ partial: (Range<Int>) -> GeoExtent) -> GeoExtent {
+        var result = GeoExtent()
+        let lock = NSLock()
+        GeoBatch.concurrentChunks(count: count, minimumChunk: 262_144) { range in
+            let extent = partial(range)
+            lock.lock()
+            result.merge(extent)
+            lock.unlock()
+        }
+        return result
+    }
+
+    mutating func addPoints(latitudes: UnsafePointer<Double>, longitudes: UnsafePointer<Double>, count: Int) {
+        var scratch = [Double](repeating: 0, count: min(GeoExtent.blockSize, count))
+        scratch.withUnsafeMutableBufferPointer { buffer in
+            let shifted = buffer.baseAddress!
+            var offset = 0
+            while offset < count {
+                let n = min(GeoExtent.blockSize, count - offset)
+                let lons = longitudes + offset
+                for i in 0..<n {
+                    shifted[i] = GeoBox.wrappedOffset(lons[i])
+                }
+                var block = GeoExtent()
+                let length = vDSP_Length(n)
+                vDSP_minvD(latitudes + offset, 1, &block.south, length)
+                vDSP_maxvD(latitudes + offset, 1, &block.north, length)
+                vDSP_minvD(lons, 1, &block.westA, length)
+                vDSP_maxvD(lons, 1, &block.eastA, length)
+                vDSP_minvD(shifted, 1, &block.westB, length)
+                vDSP_maxvD(shifted, 1, &block.eastB, length)
+                merge(block)
+                offset += n
+            }
+        }
+    }
+
+    mutating func addBoxes(norths: UnsafePointer<Double>, souths: UnsafePointer<Double>,
+                           wests: UnsafePointer<Double>, easts: UnsafePointer<Double>, count: Int) {
+        let blockSize = min(GeoExtent.blockSize, count)
+        var scratch = [Double](repeating: 0, count: 3 * blockSize)
+        scratch.withUnsafeMutableBufferPointer { buffer in
+            let spans = buffer.baseAddress!
+            let shiftedWests = spans + blockSize
+            let ends = shiftedWests + blockSize
+            var offset = 0
+            while offset < count {
+                let n = min(blockSize, count - offset)
+                let w = wests + offset
+                let e = easts + offset
+                for i in 0..<n {
+                    spans[i] = GeoBox.wrappedOffset(e[i] - w[i])
+                    shiftedWests[i] = GeoBox.wrappedOffset(w[i])
+                }
+                var block = GeoExtent()
+                let length = vDSP_Length(n)
+                vDSP_minvD(souths + offset, 1, &block.south, length)
+                vDSP_maxvD(norths + offset, 1, &block.north, length)
+                vDSP_minvD(w, 1, &block.westA, length)
+                vDSP_vaddD(w, 1, spans, 1, ends, 1, length)
+                vDSP_maxvD(ends, 1, &block.eastA, length)
+                vDSP_minvD(shiftedWests, 1, &block.westB, length)
+                vDSP_vaddD(shiftedWests, 1, spans, 1, ends, 1, length)
+                vDSP_maxvD(ends, 1, &block.eastB, length)
+                merge(block)
+                offset += n
+            }
+        }
+    }
+}
@@ -0,0 +1,309 @@
+//
+//  GeoCellId.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+
+/// 64-bit hierarchical cell id over the latitude/longitude plane, laid out like S2 cell ids.
+///
+/// Each level splits a cell into four, down to level 30 (about 4 cm x 2 cm cells at the
+/// equator). The id holds the Z-order (Morton) position of the cell followed by a single
+/// sentinel bit that marks the level, so:
+/// * all descendants of a cell fall in `rangeMin...rangeMax`, and a sorted array of leaf
+///   ids can be scanned for any cell or box covering with two binary searches;
+/// * parent and child ids are plain bit arithmetic, no decoding.
+struct GeoCellId {
+
+    static let maxLevel = 30
+    fileprivate static let cellsPerAxis = Double(1 << 30)
+
+    let rawValue: UInt64
+
+    init(rawValue: UInt64) {
+        self.rawValue = rawValue
+    }
+
+    /// Cell containing the point at `level`. Branch-free apart from the clamping selects.
+    init(latitude: Double, longitude: Double, level: Int = GeoCellId.maxLevel) {
+        // Checked here too: the shifts below would trap on a bad level first.
+        precondition(level >= 0 && level <= GeoCellId.maxLevel, "GeoCellId: invalid level")
+        let (i, j) = GeoCellId.leafPosition(latitude: latitude, longitude: longitude)
+        self.init(i: i >> UInt64(GeoCellId.maxLevel - level), j: j >> UInt64(GeoCellId.maxLevel - level), level: level)
+    }
+
+    init(_ coordinates: NMAGeoCoordinates, level: Int = GeoCellId.maxLevel) {
+        self.init(latitude: coordinates.latitude, longitude: coordinates.longitude, level: level)
+    }
+
+    /// Cell at `level` from its column `i` (longitude) and row `j` (latitude), both in [0, 2^level).
+    init(i: UInt64, j: UInt64, level: Int) {
+        precondition(level >= 0 && level <= GeoCellId.maxLevel, "GeoCellId: invalid level")
+        let shift = UInt64(2 * (GeoCellId.maxLevel - level))
+        let position = GeoCellId.interleave(i: i, j: j) << shift
+        rawValue = position << 1 | (1 << shift)
+    }
+
+    var isValid: Bool {
+        let trailingZeros = Int(ffsll(Int64(bitPattern: rawValue))) - 1
+        return rawValue != 0 && trailingZeros % 2 == 0 && rawValue >> 61 == 0
+    }
+
+    /// Lowest set bit, the level sentinel.
+    fileprivate var lowestBit: UInt64 {
+        return rawValue & (~rawValue &+ 1)
+    }
+
+    var level: Int {
+        let trailingZeros = Int(ffsll(Int64(bitPattern: rawValue))) - 1
+        return GeoCellId.maxLevel - trailingZeros / 2
+    }
+
+    var isLeaf: Bool {
+        return rawValue & 1 != 0
+    }
+
+    // MARK: Hierarchy
+
+    /// Smallest leaf id inside this cell.
+    var rangeMin: GeoCellId {
+        return GeoCellId(rawValue: rawValue - (lowestBit - 1))
+    }
+
+    /// Largest leaf id inside this cell.
+    var rangeMax: GeoCellId {
+        return GeoCellId(rawValue: rawValue + (lowestBit - 1))
+    }
+
+    func contains(_ other: GeoCellId) -> Bool {
+        return other.rawValue >= rangeMin.rawValue && other.rawValue <= rangeMax.rawValue
+    }
+
+    var parent: GeoCellId {
+        return parent(level: level - 1)
+    }
+
+    func parent(level: Int) -> GeoCellId {
+        precondition(level >= 0 && level <= self.level, "GeoCellId: invalid parent level")
+        let bit: UInt64 = 1 << UInt64(2 * (GeoCellId.maxLevel - level))
+        return GeoCellId(rawValue: (rawValue & (~bit &+ 1)) | bit)
+    }
+
+    /// Child `position` (0...3) in Z order.
+    func child(_ position: Int) -> GeoCellId {
+        precondition(!isLeaf && position >= 0 && position < 4, "GeoCellId: invalid child")
+        let childBit = lowestBit >> 2
+        return GeoCellId(rawValue: rawValue - lowestBit + UInt64(2 * position + 1) * childBit)
+    }
+
+    var children: [GeoCellId] {
+        return (0..<4).map { child($0) }
+    }
+
+    // MARK: Neighbors
+
+    /// Column and row of this cell at its own level.
+    var position: (i: UInt64, j: UInt64) {
+        let shift = UInt64(2 * (GeoCellId.maxLevel - level) + 1)
+        let (i, j) = GeoCellId.deinterleave(rawValue >> shift)
+        return (i: i, j: j)
+    }
+
+    /// Same-level neighbor `di` columns east and `dj` rows north. Longitude wraps around
+    /// the date line; returns nil past the poles.
+    func neighbor(di: Int, dj: Int) -> GeoCellId? {
+        let level = self.level
+        let size = Int64(1) << Int64(level)
+        let (i, j) = position
+        let row = Int64(j) + Int64(dj)
+        guard row >= 0 && row < size else { return nil }
+        let column = ((Int64(i) + Int64(di)) % size + size) % size
+        return GeoCellId(i: UInt64(column), j: UInt64(row), level: level)
+    }
+
+    /// East, north, west and south neighbors.
+    var edgeNeighbors: [GeoCellId] {
+        return [(1, 0), (0, 1), (-1, 0), (0, -1)].flatMap { neighbor(di: $0.0, dj: $0.1) }
+    }
+
+    /// All eight surrounding cells (fewer at the poles).
+    var allNeighbors: [GeoCellId] {
+        var result = [GeoCellId]()
+        for dj in -1...1 {
+            for di in -1...1 where di != 0 || dj != 0 {
+                if let cell = neighbor(di: di, dj: dj) {
+                    result.append(cell)
+                }
+            }
+        }
+        return result
+    }
+
+    // MARK: Geometry
+
+    var box: GeoBox {
+        let size = Double(UInt64(1) << UInt64(level))
+        let (i, j) = position
+        return GeoBox(north: (Double(j) + 1) / size * 180 - 90, south: Double(j) / size * 180 - 90,
+                      west: Double(i) / size * 360 - 180, east: (Double(i) + 1) / size * 360 - 180)
+    }
+
+    /// Leaf ranges covering `box`, using the finest level up to `maxLevel` that needs at most
+    /// `maxCells` cells. Adjacent ranges are merged; the result is sorted.
+    static func covering(_ box: GeoBox, maxLevel: Int = GeoCellId.maxLevel, maxCells: Int = 64) -> [GeoCellRange] {
+        let (westI, southJ) = leafPosition(latitude: box.south, longitude: box.west)
+        let (eastI, northJ) = leafPosition(latitude: box.north, longitude: box.east)
+        let wraps = box.crossesDateLine || box.longitudeSpan >= 360
+
+        var level = min(maxLevel, GeoCellId.maxLevel)
+        var columns = [UInt64](), rows = (first: UInt64(0), last: UInt64(0))
+        while true {
+            let shift = UInt64(GeoCellId.maxLevel - level)
+            let size = UInt64(1) << UInt64(level)
+            let i0 = westI >> shift, i1 = eastI >> shift
+            let columnCount = box.longitudeSpan >= 360 ? size : min(size, wraps ? size - i0 + i1 + 1 : i1 - i0 + 1)
+            rows = (first: southJ >> shift, last: northJ >> shift)
+            let cellCount = columnCount * (rows.last - rows.first + 1)
+            if cellCount <= UInt64(maxCells) || level == 0 {
+                columns = (0..<columnCount).map { (i0 + $0) % size }
+                break
+            }
+            level -= 1
+        }
+
+        var ranges = [GeoCellRange]()
+        for j in rows.first...rows.last {
+            for i in columns {
+                let cell = GeoCellId(i: i, j: j, level: level)
+                ranges.append(GeoCellRange(min: cell.rangeMin, max: cell.rangeMax))
+            }
+        }
+        ranges.sort { $0.min < $1.min }
+        var merged = [GeoCellRange]()
+        for range in ranges {
+            if let last = merged.last, last.max.rawValue &+ 1 >= range.min.rawValue {
+                merged[merged.count - 1] = GeoCellRange(min: last.min, max: max(last.max, range.max))
+            } else {
+                merged.append(range)
+            }
+        }
+        return merged
+    }
+
+    // MARK: Bulk encoding
+
+    /// Encodes every point at `level`, in parallel chunks; the inner loop is straight-line
+    /// integer code the compiler can vectorize.
+    static func encode(latitudes: UnsafeBufferPointer<Double>, longitudes: UnsafeBufferPointer<Double>,
+                       level: Int = GeoCellId.maxLevel, into result: UnsafeMutableBufferPointer<UInt64>) {
+        precondition(latitudes.count == longitudes.count && result.count >= latitudes.count, "GeoCellId: buffer size mismatch")
+        precondition(level >= 0 && level <= maxLevel, "GeoCellId: invalid level")
+        guard let lats = latitudes.baseAddress, let lons = longitudes.baseAddress, let out = result.baseAddress else { return }
+        let levelShift = UInt64(maxLevel - level)
+        let positionShift = 2 * levelShift
+        let sentinel: UInt64 = 1 << positionShift
+        GeoBatch.concurrentChunks(count: latitudes.count) { range in
+            for index in range {
+                let (i, j) = leafPosition(latitude: lats[index], longitude: lons[index])
+                out[index] = (interleave(i: i >> levelShift, j: j >> levelShift) << positionShift) << 1 | sentinel
+            }
+        }
+    }
+
+    static func encode(_ points: GeoCoordinateBuffer, level: Int = GeoCellId.maxLevel) -> [UInt64] {
+        var result = [UInt64](repeating: 0, count: points.count)
+        points.withUnsafeBuffers { lats, lons, _ in
+            result.withUnsafeMutableBufferPointer { encode(latitudes: lats, longitudes: lons, level: level, into: $0) }
+        }
+        return result
+    }
+
+    /// Indices of `sortedIds` (ascending raw values) that fall inside `range`.
+    static func indices(of range: GeoCellRange, in sortedIds: [UInt64]) -> Range<Int> {
+        return lowerBound(range.min.rawValue, in: sortedIds)..<lowerBound(range.max.rawValue &+ 1, in: sortedIds)
+    }
+
+    // MARK: Bit twiddling
+
+    @inline(__always)
+    fileprivate static func leafPosition(latitude: Double, longitude: Double) -> (i: UInt64, j: UInt64) {
+        let last = cellsPerAxis - 1
+        let x = min(max((longitude + 180) / 360 * cellsPerAxis, 0), last)
+        let y = min(max((latitude + 90) / 180 * cellsPerAxis, 0), last)
+        return (i: UInt64(x), j: UInt64(y))
+    }
+
+    /// Spreads the low 32 bits of `value` into the even bit positions.
+    @inline(__always)
+    fileprivate static func spread(_ value: UInt64) -> UInt64 {
+        var x = value & 0x0000_0000_FFFF_FFFF
+        x = (x | (x << 16)) & 0x0000_FFFF_0000_FFFF
+        x = (x | (x << 8)) & 0x00FF_00FF_00FF_00FF
+        x = (x | (x << 4)) & 0x0F0F_0F0F_0F0F_0F0F
+        x = (x | (x << 2)) & 0x3333_3333_3333_3333
+        x = (x | (x << 1)) & 0x5555_5555_5555_5555
+        return x
+    }
+
+    @inline(__always)
+    fileprivate static func compact(_ value: UInt64) -> UInt64 {
+        var x = value & 0x5555_5555_5555_5555
+        x = (x | (x >> 1)) & 0x3333_3333_3333_3333
+        x = (x | (x >> 2)) & 0x0F0F_0F0F_0F0F_0F0F
+        x = (x | (x >> 4)) & 0x00FF_00FF_00FF_00FF
+        x = (x | (x >> 8)) & 0x0000_FFFF_0000_FFFF
+        x = (x | (x >> 16)) & 0x0000_0000_FFFF_FFFF
+        return x
+    }
+
+    /// Morton code with latitude in the odd bits.
+    @inline(__always)
+    fileprivate static func interleave(i: UInt64, j: UInt64) -> UInt64 {
+        return spread(j) << 1 | spread(i)
+    }
+
+    fileprivate static func deinterleave(_ morton: UInt64) -> (UInt64, UInt64) {
+        return (compact(morton), compact(morton >> 1))
+    }
+
+    fileprivate static func lowerBound(_ value: UInt64, in sorted: [UInt64]) -> Int {
+        var low = 0
+        var high = sorted.count
+        while low < high {
+            let middle = (low + high) / 2
+            if sorted[middle] < value {
+                low = middle + 1
+            } else {
+                high = middle
+            }
+        }
+        return low
+    }
+}
+
+/// Inclusive range of leaf cell ids.
+struct GeoCellRange {
+    let min: GeoCellId
+    let max: GeoCellId
+
+    func contains(_ cell: GeoCellId) -> Bool {
+        return cell.rawValue >= min.rawValue && cell.rawValue <= max.rawValue
+    }
+}
+
+extension GeoCellId: Hashable, Comparable {
+    var hashValue: Int {
+        return rawValue.hashValue
+    }
+
+    static func == (lhs: GeoCellId, rhs: GeoCellId) -> Bool {
+        return lhs.rawValue == rhs.rawValue
+    }
+
+    static func < (lhs: GeoCellId, rhs: GeoCellId) -> Bool {
+        return lhs.rawValue < rhs.rawValue
+    }
+}
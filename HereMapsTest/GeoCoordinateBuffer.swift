@@ -0,0 +1,193 @@
+//
+//  GeoCoordinateBuffer.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+import Accelerate
+
+/// Packed struct-of-arrays vertex storage for polylines, polygons and point sets.
+///
+/// Latitudes, longitudes and altitudes live in three contiguous arrays, so a 200k
+/// vertex route is three allocations instead of 200k `NMAGeoCoordinates`. The
+/// arrays are copy-on-write: passing a buffer around or reading it never copies.
+/// `NMAGeoCoordinates` objects are only created at the SDK boundary, see `geoCoordinates()`.
+struct GeoCoordinateBuffer {
+
+    fileprivate(set) var latitudes: [Double]
+    fileprivate(set) var longitudes: [Double]
+    fileprivate(set) var altitudes: [Float]
+
+    var count: Int {
+        return latitudes.count
+    }
+
+    var isEmpty: Bool {
+        return latitudes.isEmpty
+    }
+
+    init() {
+        latitudes = []
+        longitudes = []
+        altitudes = []
+    }
+
+    init(capacity: Int) {
+        self.init()
+        reserveCapacity(capacity)
+    }
+
+    /// Takes ownership of existing arrays; `altitudes` defaults to zero.
+    init(latitudes: [Double], longitudes: [Double], altitudes: [Float]? = nil) {
+        precondition(latitudes.count == longitudes.count, "GeoCoordinateBuffer: latitude/longitude count mismatch")
+        self.latitudes = latitudes
+        self.longitudes = longitudes
+        self.altitudes = altitudes ?? [Float](repeating: 0, count: latitudes.count)
+        precondition(self.altitudes.count == latitudes.count, "GeoCoordinateBuffer: altitude count mismatch")
+    }
+
+    /// Loads interleaved latitude/longitude pairs (e.g. a decoded route shape) without per-vertex work.
+    init(interleaved pairs: UnsafeBufferPointer<Double>) {
+        precondition(pairs.count % 2 == 0, "GeoCoordinateBuffer: odd number of interleaved values")
+        let count = pairs.count / 2
+        var latitudes = [Double](repeating: 0, count: count)
+        var longitudes = [Double](repeating: 0, count: count)
+        if let source = pairs.baseAddress, count > 0 {
+            latitudes.withUnsafeMutableBufferPointer { lats in
+                longitudes.withUnsafeMutableBufferPointer { lons in
+                    var split = DSPDoubleSplitComplex(realp: lats.baseAddress!, imagp: lons.baseAddress!)
+                    source.withMemoryRebound(to: DSPDoubleComplex.self, capacity: count) { complex in
+                        vDSP_ctozD(complex, 2, &split, 1, vDSP_Length(count))
+                    }
+                }
+            }
+        }
+        self.init(latitudes: latitudes, longitudes: longitudes)
+    }
+
+    init(coordinates: [NMAGeoCoordinates]) {
+        self.init(capacity: coordinates.count)
+        for coordinate in coordinates {
+            append(coordinate)
+        }
+    }
+
+    // MARK: Editing
+
+    mutating func reserveCapacity(_ capacity: Int) {
+        latitudes.reserveCapacity(capacity)
+        longitudes.reserveCapacity(capacity)
+        altitudes.reserveCapacity(capacity)
+    }
+
+    mutating func append(latitude: Double, longitude: Double, altitude: Float = 0) {
+        latitudes.append(latitude)
+        longitudes.append(longitude)
+        altitudes.append(altitude)
+    }
+
+    mutating func append(_ coordinates: NMAGeoCoordinates) {
+        append(latitude: coordinates.latitude, longitude: coordinates.longitude, altitude: coordinates.altitude)
+    }
+
+    mutating func append(contentsOf other: GeoCoordinateBuffer) {
+        latitudes.append(contentsOf: other.latitudes)
+        longitudes.append(contentsOf: other.longitudes)
+        altitudes.append(contentsOf: other.altitudes)
+    }
+
+    mutating func insert(latitude: Double, longitude: Double, altitude: Float = 0, at index: Int) {
+        latitudes.insert(latitude, at: index)
+        longitudes.insert(longitude, at: index)
+        altitudes.insert(altitude, at: index)
+    }
+
+    mutating func remove(at index: Int) {
+        latitudes.remove(at: index)
+        longitudes.remove(at: index)
+        altitudes.remove(at: index)
+    }
+
+    mutating func removeLast() {
+        remove(at: count - 1)
+    }
+
+    mutating func removeAll(keepingCapacity keepCapacity: Bool = false) {
+        latitudes.removeAll(keepingCapacity: keepCapacity)
+        longitudes.removeAll(keepingCapacity: keepCapacity)
+        altitudes.removeAll(keepingCapacity: keepCapacity)
+    }
+
+    // MARK: Access
+
+    func geoCoordinates(at index: Int) -> NMAGeoCoordinates {
+        return NMAGeoCoordinates(latitude: latitudes[index], longitude: longitudes[index], altitude: Double(altitudes[index]))
+    }
+
+    /// Materializes the vertices for SDK calls that only take `NSArray<NMAGeoCoordinates>`.
+    func geoCoordinates() -> [NMAGeoCoordinates] {
+        var result = [NMAGeoCoordinates]()
+        result.reserveCapacity(count)
+        for i in 0..<count {
+            result.append(geoCoordinates(at: i))
+        }
+        return result
+    }
+
+    /// Zero-copy access to the packed arrays for batch kernels.
+    func withUnsafeBuffers<R>(_ body: (UnsafeBufferPointer<Double>, UnsafeBufferPointer<Double>, UnsafeBufferPointer<Float>) throws -> R) rethrows -> R {
+        return try latitudes.withUnsafeBufferPointer { lats in
+            try longitudes.withUnsafeBufferPointer { lons in
+                try altitudes.withUnsafeBufferPointer { alts in
+                    try body(lats, lons, alts)
+                }
+            }
+        }
+    }
+
+    /// In-place access to the packed arrays; the vertex count must not change.
+    mutating func withUnsafeMutableBuffers<R>(_ body: (UnsafeMutableBufferPointer<Double>, UnsafeMutableBufferPointer<Double>, UnsafeMutableBufferPointer<Float>) throws -> R) rethrows -> R {
+        return try latitudes.withUnsafeMutableBufferPointer { lats in
+            try longitudes.withUnsafeMutableBufferPointer { lons in
+                try altitudes.withUnsafeMutableBufferPointer { alts in
+                    try body(lats, lons, alts)
+                }
+            }
+        }
+    }
+
+    // MARK: Batch geometry
+
+    func distances(from origin: NMAGeoCoordinates) -> [Double] {
+        return GeoBatch.distances(from: origin, latitudes: latitudes, longitudes: longitudes)
+    }
+
+    func headings(from origin: NMAGeoCoordinates) -> [Double] {
+        return GeoBatch.headings(from: origin, latitudes: latitudes, longitudes: longitudes)
+    }
+}
+
+// MARK: SDK interop
+
+extension NMAMapPolyline {
+    convenience init(buffer: GeoCoordinateBuffer) {
+        self.init(vertices: buffer.geoCoordinates())
+    }
+
+    var vertexBuffer: GeoCoordinateBuffer {
+        return GeoCoordinateBuffer(coordinates: vertices)
+    }
+}
+
+extension NMAMapPolygon {
+    convenience init(buffer: GeoCoordinateBuffer) {
+        self.init(vertices: buffer.geoCoordinates())
+    }
+
+    var vertexBuffer: GeoCoordinateBuffer {
+        return GeoCoordinateBuffer(coordinates: vertices)
+    }
+}
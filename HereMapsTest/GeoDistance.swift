@@ -0,0 +1,179 @@
+//
+//  GeoDistance.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+import Accelerate
+
+/// Distance formula to use, from fastest to most accurate. Pick one per call site.
+enum GeoDistanceAccuracy {
+    /// Flat-earth approximation around the mean latitude, on the `GeoBatch.earthRadius` sphere.
+    /// Relative error against `haversine` stays below 0.1% for distances under 100 km with
+    /// |latitude| < 70; it grows quickly beyond that. Use for short-range neighbor filtering.
+    case equirectangular
+    /// Great-circle distance on the sphere, what `NMAGeoCoordinates.distance(to:)` uses.
+    /// Exact on the sphere; against WGS84 the error is up to about 0.5%.
+    case haversine
+    /// Ellipsoidal distance on WGS84 (Vincenty inverse formula), accurate to about 0.5 mm.
+    /// For nearly antipodal points, where the iteration does not converge, falls back to
+    /// `haversine` scaled to the WGS84 mean radius (error up to about 0.5%).
+    case geodesic
+}
+
+extension GeoBatch {
+
+    // WGS84 ellipsoid
+    static let wgs84SemiMajorAxis: Double = 6378137
+    static let wgs84Flattening: Double = 1 / 298.257223563
+    static let wgs84SemiMinorAxis: Double = wgs84SemiMajorAxis * (1 - wgs84Flattening)
+    static let wgs84MeanRadius: Double = (2 * wgs84SemiMajorAxis + wgs84SemiMinorAxis) / 3
+
+    // MARK: Scalar
+
+    static func distance(fromLatitude lat1: Double, longitude lon1: Double, toLatitude lat2: Double, longitude lon2: Double,
+                         accuracy: GeoDistanceAccuracy) -> Double {
+        switch accuracy {
+        case .equirectangular:
+            return equirectangularDistance(fromLatitude: lat1, longitude: lon1, toLatitude: lat2, longitude: lon2)
+        case .haversine:
+            return distance(fromLatitude: lat1, longitude: lon1, toLatitude: lat2, longitude: lon2)
+        case .geodesic:
+            return geodesicDistance(fromLatitude: lat1, longitude: lon1, toLatitude: lat2, longitude: lon2)
+        }
+    }
+
+    static func equirectangularDistance(fromLatitude lat1: Double, longitude lon1: Double, toLatitude lat2: Double, longitude lon2: Double) -> Double {
+        var dLon = (lon2 - lon1).truncatingRemainder(dividingBy: 360)
+        dLon = dLon > 180 ? dLon - 360 : (dLon < -180 ? dLon + 360 : dLon)
+        let x = dLon * cos((lat1 + lat2) / 2 * degreesToRadians)
+        let y = lat2 - lat1
+        return earthRadius * degreesToRadians * sqrt(x * x + y * y)
+    }
+
+    /// Vincenty's inverse formula on the WGS84 ellipsoid.
+    static func geodesicDistance(fromLatitude lat1: Double, longitude lon1: Double, toLatitude lat2: Double, longitude lon2: Double) -> Double {
+        let a = wgs84SemiMajorAxis, b = wgs84SemiMinorAxis, f = wgs84Flattening
+        let l = (lon2 - lon1) * degreesToRadians
+        let u1 = atan((1 - f) * tan(lat1 * degreesToRadians))
+        let u2 = atan((1 - f) * tan(lat2 * degreesToRadians))
+        let sinU1 = sin(u1), cosU1 = cos(u1)
+        let sinU2 = sin(u2), cosU2 = cos(u2)
+
+        var lambda = l
+        var sinSigma: Double = 0, cosSigma: Double = 0, sigma: Double = 0
+        var cosSqAlpha: Double = 0, cos2SigmaM: Double = 0
+        var converged = false
+        for _ in 0..<100 {
+            let sinLambda = sin(lambda), cosLambda = cos(lambda)
+            let t1 = cosU2 * sinLambda
+            let t2 = cosU1 * sinU2 - sinU1 * cosU2 * cosLambda
+            sinSigma = sqrt(t1 * t1 + t2 * t2)
+            if sinSigma == 0 {
+                return 0 // coincident points
+            }
+            cosSigma = sinU1 * sinU2 + cosU1 * cosU2 * cosLambda
+            sigma = atan2(sinSigma, cosSigma)
+            let sinAlpha = cosU1 * cosU2 * sinLambda / sinSigma
+            cosSqAlpha = 1 - sinAlpha * sinAlpha
+            // Both points on the equator: cosSqAlpha == 0.
+            cos2SigmaM = cosSqAlpha != 0 ? cosSigma - 2 * sinU1 * sinU2 / cosSqAlpha : 0
+            let c = f / 16 * cosSqAlpha * (4 + f * (4 - 3 * cosSqAlpha))
+            let previous = lambda
+            lambda = l + (1 - c) * f * sinAlpha
+                * (sigma + c * sinSigma * (cos2SigmaM + c * cosSigma * (-1 + 2 * cos2SigmaM * cos2SigmaM)))
+            if abs(lambda - previous) < 1e-12 {
+                converged = true
+                break
+            }
+        }
+        guard converged else {
+            return distance(fromLatitude: lat1, longitude: lon1, toLatitude: lat2, longitude: lon2) * wgs84MeanRadius / earthRadius
+        }
+
+        let uSq = cosSqAlpha * (a * a - b * b) / (b * b)
+        let bigA = 1 + uSq / 16384 * (4096 + uSq * (-768 + uSq * (320 - 175 * uSq)))
+        let bigB = uSq / 1024 * (256 + uSq * (-128 + uSq * (74 - 47 * uSq)))
+        let deltaSigma = bigB * sinSigma * (cos2SigmaM + bigB / 4 * (cosSigma * (-1 + 2 * cos2SigmaM * cos2SigmaM)
+            - bigB / 6 * cos2SigmaM * (-3 + 4 * sinSigma * sinSigma) * (-3 + 4 * cos2SigmaM * cos2SigmaM)))
+        return b * bigA * (sigma - deltaSigma)
+    }
+
+    // MARK: Batch
+
+    /// Writes the distance in meters from the origin to every point into `result`.
+    static func distances(fromLatitude latitude: Double, longitude: Double,
+                          latitudes: UnsafeBufferPointer<Double>, longitudes: UnsafeBufferPointer<Double>,
+                          into result: UnsafeMutableBufferPointer<Double>, accuracy: GeoDistanceAccuracy) {
+        switch accuracy {
+        case .haversine:
+            distances(fromLatitude: latitude, longitude: longitude, latitudes: latitudes, longitudes: longitudes, into: result)
+        case .equirectangular:
+            equirectangularDistances(fromLatitude: latitude, longitude: longitude, latitudes: latitudes, longitudes: longitudes, into: result)
+        case .geodesic:
+            precondition(latitudes.count == longitudes.count && result.count >= latitudes.count, "GeoBatch: buffer size mismatch")
+            guard let lats = latitudes.baseAddress, let lons = longitudes.baseAddress, let out = result.baseAddress else { return }
+            // Iterative per point, so spread over cores instead of vector lanes.
+            concurrentChunks(count: latitudes.count, minimumChunk: 4096) { range in
+                for i in range {
+                    out[i] = geodesicDistance(fromLatitude: latitude, longitude: longitude, toLatitude: lats[i], longitude: lons[i])
+                }
+            }
+        }
+    }
+
+    static func distances(from origin: NMAGeoCoordinates, latitudes: [Double], longitudes: [Double], accuracy: GeoDistanceAccuracy) -> [Double] {
+        var result = [Double](repeating: 0, count: latitudes.count)
+        latitudes.withUnsafeBufferPointer { lats in
+            longitudes.withUnsafeBufferPointer { lons in
+                result.withUnsafeMutableBufferPointer { out in
+                    distances(fromLatitude: origin.latitude, longitude: origin.longitude,
+                              latitudes: lats, longitudes: lons, into: out, accuracy: accuracy)
+                }
+            }
+        }
+        return result
+    }
+
+    fileprivate static func equirectangularDistances(fromLatitude latitude: Double, longitude: Double,
+                                                     latitudes: UnsafeBufferPointer<Double>, longitudes: UnsafeBufferPointer<Double>,
+                                                     into result: UnsafeMutableBufferPointer<Double>) {
+        precondition(latitudes.count == longitudes.count && result.count >= latitudes.count, "GeoBatch: buffer size mismatch")
+        let count = latitudes.count
+        guard count > 0, let lats = latitudes.baseAddress, let lons = longitudes.baseAddress, let out = result.baseAddress else { return }
+
+        let chunkSize = 1024
+        var halfScale = degreesToRadians / 2, halfOrigin = latitude * degreesToRadians / 2
+        var minusLatitude = -latitude, minusLongitude = -longitude
+        var inverse360 = 1.0 / 360, minus360 = -360.0
+        var scale = earthRadius * degreesToRadians
+        var scratch = [Double](repeating: 0, count: 3 * chunkSize)
+        scratch.withUnsafeMutableBufferPointer { buffer in
+            let dx = buffer.baseAddress!
+            let dy = dx + chunkSize
+            let t = dy + chunkSize
+            var offset = 0
+            while offset < count {
+                let n = min(chunkSize, count - offset)
+                var n32 = Int32(n)
+                let length = vDSP_Length(n)
+                // dLon wrapped into [-180, 180]
+                vDSP_vsaddD(lons + offset, 1, &minusLongitude, dx, 1, length)
+                vDSP_vsmulD(dx, 1, &inverse360, t, 1, length)
+                vvnint(t, t, &n32)
+                vDSP_vsmaD(t, 1, &minus360, dx, 1, dx, 1, length)
+                // dx *= cos(mean latitude)
+                vDSP_vsmsaD(lats + offset, 1, &halfScale, &halfOrigin, t, 1, length)
+                vvcos(t, t, &n32)
+                vDSP_vmulD(dx, 1, t, 1, dx, 1, length)
+                vDSP_vsaddD(lats + offset, 1, &minusLatitude, dy, 1, length)
+                vDSP_vdistD(dx, 1, dy, 1, out + offset, 1, length)
+                vDSP_vsmulD(out + offset, 1, &scale, out + offset, 1, length)
+                offset += n
+            }
+        }
+    }
+}
@@ -0,0 +1,257 @@
+//
+//  GeoGapBuffer.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+
+/// Vertex storage for interactive editing of long polylines and polygons.
+///
+/// Same struct-of-arrays layout as `GeoCoordinateBuffer`, but with a gap of free slots kept
+/// at the last edit position. An insert or remove moves the gap there first, which only
+/// shifts the vertices between the old and new position, so edits around a cursor are
+/// amortized O(1) instead of shifting the whole tail each time.
+///
+/// Reads never flatten the storage: `withUnsafeView` hands out the two runs on either side
+/// of the gap.
+struct GeoGapBuffer {
+
+    fileprivate var latitudes: [Double] = []
+    fileprivate var longitudes: [Double] = []
+    fileprivate var altitudes: [Float] = []
+    fileprivate var gapStart = 0
+    fileprivate var gapEnd = 0
+
+    init() {
+    }
+
+    init(_ buffer: GeoCoordinateBuffer) {
+        latitudes = buffer.latitudes
+        longitudes = buffer.longitudes
+        altitudes = buffer.altitudes
+        gapStart = buffer.count
+        gapEnd = buffer.count
+    }
+
+    var count: Int {
+        return latitudes.count - (gapEnd - gapStart)
+    }
+
+    var isEmpty: Bool {
+        return count == 0
+    }
+
+    /// Index where the next edit is cheapest.
+    var cursor: Int {
+        return gapStart
+    }
+
+    // MARK: Editing
+
+    mutating func insert(latitude: Double, longitude: Double, altitude: Float = 0, at index: Int) {
+        precondition(index >= 0 && index <= count, "GeoGapBuffer: index out of range")
+        if gapStart == gapEnd {
+            grow()
+        }
+        moveGap(to: index)
+        latitudes[gapStart] = latitude
+        longitudes[gapStart] = longitude
+        altitudes[gapStart] = altitude
+        gapStart += 1
+    }
+
+    mutating func insert(_ coordinates: NMAGeoCoordinates, at index: Int) {
+        insert(latitude: coordinates.latitude, longitude: coordinates.longitude, altitude: Float(coordinates.altitude), at: index)
+    }
+
+    mutating func append(latitude: Double, longitude: Double, altitude: Float = 0) {
+        insert(latitude: latitude, longitude: longitude, altitude: altitude, at: count)
+    }
+
+    mutating func remove(at index: Int) {
+        precondition(index >= 0 && index < count, "GeoGapBuffer: index out of range")
+        moveGap(to: index)
+        gapEnd += 1
+    }
+
+    /// Moves vertex `index` without touching the gap.
+    mutating func replace(at index: Int, latitude: Double, longitude: Double, altitude: Float = 0) {
+        let i = physical(index)
+        latitudes[i] = latitude
+        longitudes[i] = longitude
+        altitudes[i] = altitude
+    }
+
+    mutating func removeAll() {
+        self = GeoGapBuffer()
+    }
+
+    // MARK: Access
+
+    func latitude(at index: Int) -> Double {
+        return latitudes[physical(index)]
+    }
+
+    func longitude(at index: Int) -> Double {
+        return longitudes[physical(index)]
+    }
+
+    func geoCoordinates(at index: Int) -> NMAGeoCoordinates {
+        let i = physical(index)
+        return NMAGeoCoordinates(latitude: latitudes[i], longitude: longitudes[i], altitude: Double(altitudes[i]))
+    }
+
+    /// Copy without the gap, for batch kernels and SDK calls that need one contiguous buffer.
+    var buffer: GeoCoordinateBuffer {
+        var lats = Array(latitudes[0..<gapStart]), lons = Array(longitudes[0..<gapStart]), alts = Array(altitudes[0..<gapStart])
+        lats.append(contentsOf: latitudes[gapEnd..<latitudes.count])
+        lons.append(contentsOf: longitudes[gapEnd..<longitudes.count])
+        alts.append(contentsOf: altitudes[gapEnd..<altitudes.count])
+        return GeoCoordinateBuffer(latitudes: lats, longitudes: lons, altitudes: alts)
+    }
+
+    /// Zero-copy access to the vertices before and after the gap.
+    func withUnsafeView<R>(_ body: (GeoGapBufferView) throws -> R) rethrows -> R {
+        return try latitudes.withUnsafeBufferPointer { lats in
+            try longitudes.withUnsafeBufferPointer { lons in
+                try altitudes.withUnsafeBufferPointer { alts in
+                    try body(GeoGapBufferView(latitudes: lats, longitudes: lons, altitudes: alts, gapStart: gapStart, gapEnd: gapEnd))
+                }
+            }
+        }
+    }
+
+    // MARK: Gap
+
+    fileprivate func physical(_ index: Int) -> Int {
+        precondition(index >= 0 && index < count, "GeoGapBuffer: index out of range")
+        return index < gapStart ? index : index + (gapEnd - gapStart)
+    }
+
+    fileprivate mutating func moveGap(to index: Int) {
+        guard index != gapStart else { return }
+        let gap = gapEnd - gapStart
+        if index < gapStart {
+            // Vertices index..<gapStart slide up behind the gap.
+            let moved = gapStart - index
+            GeoGapBuffer.shift(&latitudes, from: index, to: index + gap, count: moved)
+            GeoGapBuffer.shift(&longitudes, from: index, to: index + gap, count: moved)
+            GeoGapBuffer.shift(&altitudes, from: index, to: index + gap, count: moved)
+        } else {
+            // Vertices after the gap slide down in front of it.
+            let moved = index - gapStart
+            GeoGapBuffer.shift(&latitudes, from: gapEnd, to: gapStart, count: moved)
+            GeoGapBuffer.shift(&longitudes, from: gapEnd, to: gapStart, count: moved)
+            GeoGapBuffer.shift(&altitudes, from: gapEnd, to: gapStart, count: moved)
+        }
+        gapStart = index
+        gapEnd = index + gap
+    }
+
+    fileprivate static func shift<T>(_ values: inout [T], from source: Int, to destination: Int, count: Int) {
+        guard count > 0 else { return }
+        values.withUnsafeMutableBufferPointer { buffer in
+            let base = buffer.baseAddress!
+            memmove(base + destination, base + source, count * MemoryLayout<T>.stride)
+        }
+    }
+
+    /// Doubles the storage, keeping the gap where it is.
+    fileprivate mutating func grow() {
+        let added = max(latitudes.count, 16)
+        let tail = latitudes.count - gapEnd
+        latitudes.insert(contentsOf: repeatElement(0, count: added), at: gapEnd)
+        longitudes.insert(contentsOf: repeatElement(0, count: added), at: gapEnd)
+        altitudes.insert(contentsOf: repeatElement(0, count: added), at: gapEnd)
+        gapEnd = latitudes.count - tail
+    }
+}
+
+/// The two runs of a `GeoGapBuffer`, valid inside `withUnsafeView`.
+struct GeoGapBufferView {
+
+    let latitudes: UnsafeBufferPointer<Double>
+    let longitudes: UnsafeBufferPointer<Double>
+    let altitudes: UnsafeBufferPointer<Float>
+    let gapStart: Int
+    let gapEnd: Int
+
+    var count: Int {
+        return latitudes.count - (gapEnd - gapStart)
+    }
+
+    /// Storage ranges holding the vertices, in order.
+    var runs: [CountableRange<Int>] {
+        return [0..<gapStart, gapEnd..<latitudes.count]
+    }
+
+    func latitude(at index: Int) -> Double {
+        return latitudes[index < gapStart ? index : index + gapEnd - gapStart]
+    }
+
+    func longitude(at index: Int) -> Double {
+        return longitudes[index < gapStart ? index : index + gapEnd - gapStart]
+    }
+
+    func altitude(at index: Int) -> Float {
+        return altitudes[index < gapStart ? index : index + gapEnd - gapStart]
+    }
+}
+
+// MARK: SDK interop
+
+/// Map objects with index-based vertex editing.
+protocol VertexEditable: class {
+    func add(_ vertex: NMAGeoCoordinates, at index: UInt)
+    func remove(at index: UInt)
+}
+
+extension NMAMapPolyline: VertexEditable {}
+extension NMAMapPolygon: VertexEditable {}
+
+/// Edits a polyline or polygon through a `GeoGapBuffer`, forwarding each edit to the map
+/// object with `add(_:at:)` / `remove(at:)` so the object's `vertices` array is never read
+/// back or replaced while editing.
+final class VertexEditor {
+
+    let object: VertexEditable
+    fileprivate(set) var vertices: GeoGapBuffer
+
+    init(polyline: NMAMapPolyline) {
+        object = polyline
+        vertices = GeoGapBuffer(polyline.vertexBuffer)
+    }
+
+    init(polygon: NMAMapPolygon) {
+        object = polygon
+        vertices = GeoGapBuffer(polygon.vertexBuffer)
+    }
+
+    var count: Int {
+        return vertices.count
+    }
+
+    func insert(_ coordinates: NMAGeoCoordinates, at index: Int) {
+        vertices.insert(coordinates, at: index)
+        object.add(coordinates, at: UInt(index))
+    }
+
+    func append(_ coordinates: NMAGeoCoordinates) {
+        insert(coordinates, at: count)
+    }
+
+    func remove(at index: Int) {
+        vertices.remove(at: index)
+        object.remove(at: UInt(index))
+    }
+
+    /// Moves a vertex (dragging), as a remove and an insert on the map object.
+    func replace(at index: Int, with coordinates: NMAGeoCoordinates) {
+        vertices.replace(at: index, latitude: coordinates.latitude, longitude: coordinates.longitude, altitude: Float(coordinates.altitude))
+        object.remove(at: UInt(index))
+        object.add(coordinates, at: UInt(index))
+    }
+}
@@ -0,0 +1,402 @@
+//
+//  GeoRTree.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+
+enum GeoRTreeError: Error {
+    case invalidFormat
+}
+
+/// Static, bulk-loaded R-tree over `GeoBox` entries (Sort-Tile-Recursive packing).
+///
+/// The whole tree is one flat blob: a small header, the level bounds, four doubles
+/// (west, south, east, north) per node and one `Int32` per node. Leaves store the
+/// entry index, inner nodes the index of their first child. The blob can be written
+/// to disk and opened again memory-mapped with `init(contentsOf:)`, without parsing.
+///
+/// Entries crossing the date line are stored as two halves, [west, 180] and
+/// [-180, east]; their leaf index is stored as `~index` so queries can merge them.
+final class GeoRTree {
+
+    fileprivate static let magic: Int64 = 0x3154_5247_4F45_47 // "GEOGRT1"
+    fileprivate static let headerWords = 5
+
+    /// Number of entries the tree was built from.
+    let count: Int
+    let nodeSize: Int
+
+    fileprivate let storage: NSData
+    fileprivate let levelBounds: [Int]
+    fileprivate let boxes: UnsafePointer<Double>
+    fileprivate let indices: UnsafePointer<Int32>
+
+    init(boxes entries: [GeoBox], nodeSize: Int = 16) {
+        precondition(nodeSize >= 2, "GeoRTree: node size must be at least 2")
+        precondition(entries.count < Int(Int32.max), "GeoRTree: too many entries")
+
+        var level = [PackedNode]()
+        level.reserveCapacity(entries.count)
+        for (index, box) in entries.enumerated() {
+            let id = Int32(index)
+            if box.crossesDateLine {
+                level.append(PackedNode(minX: box.west, minY: box.south, maxX: 180, maxY: box.north, index: ~id))
+                level.append(PackedNode(minX: -180, minY: box.south, maxX: box.east, maxY: box.north, index: ~id))
+            } else {
+                level.append(PackedNode(minX: box.west, minY: box.south, maxX: box.east, maxY: box.north, index: id))
+            }
+        }
+
+        var nodes = [PackedNode]()
+        var levelBounds = [Int]()
+        GeoRTree.sortTileRecursive(&level, nodeSize: nodeSize)
+        nodes.append(contentsOf: level)
+        levelBounds.append(nodes.count)
+
+        var levelStart = 0
+        while nodes.count - levelStart > 1 {
+            let levelEnd = nodes.count
+            var parents = [PackedNode]()
+            var start = levelStart
+            while start < levelEnd {
+                let end = min(start + nodeSize, levelEnd)
+                var parent = nodes[start]
+                for child in (start + 1)..<end {
+                    parent.extend(nodes[child])
+                }
+                parent.index = Int32(start)
+                parents.append(parent)
+                start = end
+            }
+            GeoRTree.sortTileRecursive(&parents, nodeSize: nodeSize)
+            nodes.append(contentsOf: parents)
+            levelBounds.append(nodes.count)
+            levelStart = levelEnd
+        }
+
+        storage = GeoRTree.pack(nodes: nodes, levelBounds: levelBounds, count: entries.count, nodeSize: nodeSize)
+        self.count = entries.count
+        self.nodeSize = nodeSize
+        self.levelBounds = levelBounds
+        (self.boxes, self.indices) = GeoRTree.sections(of: storage, nodeCount: nodes.count, levelCount: levelBounds.count)
+    }
+
+    convenience init(boundingBoxes: [NMAGeoBoundingBox], nodeSize: Int = 16) {
+        self.init(boxes: boundingBoxes.map { GeoBox($0) }, nodeSize: nodeSize)
+    }
+
+    /// Opens a tree written by `write(to:)` in read-only, memory-mapped mode.
+    init(contentsOf url: URL) throws {
+        let data = try NSData(contentsOf: url, options: .alwaysMapped)
+        let headerSize = GeoRTree.headerWords * MemoryLayout<Int64>.size
+        guard data.length >= headerSize else { throw GeoRTreeError.invalidFormat }
+        let header = data.bytes.assumingMemoryBound(to: Int64.self)
+        let nodeCount = Int(header[3])
+        let levelCount = Int(header[4])
+        guard header[0] == GeoRTree.magic, header[1] >= 2, header[2] >= 0,
+            nodeCount >= 0, nodeCount <= data.length, levelCount >= 1, levelCount <= data.length,
+            data.length == GeoRTree.byteCount(nodeCount: nodeCount, levelCount: levelCount) else {
+            throw GeoRTreeError.invalidFormat
+        }
+        // Level ends must grow strictly up to the node count, with a single root on top.
+        var levelBounds = [Int]()
+        for level in 0..<levelCount {
+            let bound = Int(header[GeoRTree.headerWords + level])
+            let previous = levelBounds.last ?? 0
+            guard bound <= nodeCount, level == 0 ? bound >= 0 : bound > previous else {
+                throw GeoRTreeError.invalidFormat
+            }
+            levelBounds.append(bound)
+        }
+        let topLevelStart = levelCount > 1 ? levelBounds[levelCount - 2] : 0
+        guard levelBounds[levelCount - 1] == nodeCount, nodeCount == 0 || nodeCount - topLevelStart == 1 else {
+            throw GeoRTreeError.invalidFormat
+        }
+
+        // Leaves must name an entry and inner nodes must start inside the level below them,
+        // or queries would read past the mapping.
+        let entryCount = Int(header[2])
+        let sections = GeoRTree.sections(of: data, nodeCount: nodeCount, levelCount: levelCount)
+        var levelStart = 0
+        for level in 0..<levelCount {
+            let children: CountableRange<Int>
+            if level == 0 {
+                children = 0..<entryCount
+            } else {
+                children = (level == 1 ? 0 : levelBounds[level - 2])..<levelBounds[level - 1]
+            }
+            for node in levelStart..<levelBounds[level] {
+                let value = sections.1[node]
+                guard children.contains(Int(level == 0 && value < 0 ? ~value : value)) else {
+                    throw GeoRTreeError.invalidFormat
+                }
+            }
+            levelStart = levelBounds[level]
+        }
+
+        storage = data
+        nodeSize = Int(header[1])
+        count = entryCount
+        self.levelBounds = levelBounds
+        (boxes, indices) = sections
+    }
+
+    func write(to url: URL) throws {
+        try storage.write(to: url, options: .atomic)
+    }
+
+    // MARK: Queries
+
+    /// Entries whose box intersects `box`.
+    func search(intersecting box: GeoBox) -> [Int] {
+        let parts = GeoRTree.planarParts(of: box)
+        // A query split at the date line can meet the same entry in both parts.
+        let isSplit = parts.count > 1
+        var found = Set<Int>()
+        var result = [Int]()
+        for query in parts {
+            visit(query) { leaf, _ in
+                let index = Int(leaf < 0 ? ~leaf : leaf)
+                if (leaf >= 0 && !isSplit) || found.insert(index).inserted {
+                    result.append(index)
+                }
+            }
+        }
+        return result
+    }
+
+    /// Entries whose box lies entirely inside `box`.
+    func search(containedIn box: GeoBox) -> [Int] {
+        var halves = [Int: Int]()
+        var result = [Int]()
+        for query in GeoRTree.planarParts(of: box) {
+            visit(query) { leaf, node in
+                guard query.contains(node) else { return }
+                if leaf >= 0 {
+                    result.append(Int(leaf))
+                } else {
+                    let index = Int(~leaf)
+                    let seen = (halves[index] ?? 0) + 1
+                    halves[index] = seen
+                    if seen == 2 {
+                        result.append(index)
+                    }
+                }
+            }
+        }
+        return result
+    }
+
+    /// Entries whose box contains the point.
+    func search(containingLatitude latitude: Double, longitude: Double) -> [Int] {
+        return search(intersecting: GeoBox(north: latitude, south: latitude, west: longitude, east: longitude))
+    }
+
+    /// Up to `k` entries nearest to the point, closest first. Distance is the
+    /// equirectangular distance to the nearest box edge (zero inside the box),
+    /// with longitudes wrapped across the date line.
+    func nearest(latitude: Double, longitude: Double, k: Int) -> [Int] {
+        guard count > 0, k > 0 else { return [] }
+        let scaleX = cos(latitude * GeoBatch.degreesToRadians)
+        func distance(_ node: Int) -> Double {
+            let box = boxes + 4 * node
+            let dy = max(0, box[1] - latitude, latitude - box[3])
+            var dx: Double = 0
+            if longitude < box[0] || longitude > box[2] {
+                dx = min(GeoBox.wrappedOffset(box[0] - longitude), GeoBox.wrappedOffset(longitude - box[2]))
+            }
+            return dy * dy + dx * dx * scaleX * scaleX
+        }
+
+        var queue = NodeQueue()
+        var found = Set<Int>()
+        var result = [Int]()
+        let root = levelBounds[levelBounds.count - 1] - 1
+        queue.push(node: root, level: levelBounds.count - 1, distance: distance(root))
+        while let entry = queue.pop() {
+            if entry.level == 0 {
+                let leaf = indices[entry.node]
+                let index = Int(leaf < 0 ? ~leaf : leaf)
+                if found.insert(index).inserted {
+                    result.append(index)
+                    if result.count == k {
+                        break
+                    }
+                }
+                continue
+            }
+            let start = Int(indices[entry.node])
+            let end = min(start + nodeSize, levelBounds[entry.level - 1])
+            for child in start..<end {
+                queue.push(node: child, level: entry.level - 1, distance: distance(child))
+            }
+        }
+        return result
+    }
+
+    // MARK: Traversal
+
+    /// Calls `body` with the leaf index and box of every leaf intersecting the planar query.
+    fileprivate func visit(_ query: PackedNode, _ body: (Int32, PackedNode) -> Void) {
+        guard count > 0 else { return }
+        var stack = [(node: levelBounds[levelBounds.count - 1] - 1, level: levelBounds.count - 1)]
+        while let (node, level) = stack.popLast() {
+            if level == 0 {
+                let leaf = self.node(at: node)
+                if leaf.intersects(query) {
+                    body(indices[node], leaf)
+                }
+                continue
+            }
+            guard self.node(at: node).intersects(query) else { continue }
+            let start = Int(indices[node])
+            let end = min(start + nodeSize, levelBounds[level - 1])
+            for child in start..<end {
+                stack.append((node: child, level: level - 1))
+            }
+        }
+    }
+
+    fileprivate func node(at index: Int) -> PackedNode {
+        let box = boxes + 4 * index
+        return PackedNode(minX: box[0], minY: box[1], maxX: box[2], maxY: box[3], index: indices[index])
+    }
+
+    /// Splits a date line crossing query into its two planar halves.
+    fileprivate static func planarParts(of box: GeoBox) -> [PackedNode] {
+        if box.crossesDateLine {
+            return [PackedNode(minX: box.west, minY: box.south, maxX: 180, maxY: box.north, index: 0),
+                    PackedNode(minX: -180, minY: box.south, maxX: box.east, maxY: box.north, index: 0)]
+        }
+        return [PackedNode(minX: box.west, minY: box.south, maxX: box.east, maxY: box.north, index: 0)]
+    }
+
+    // MARK: Packing
+
+    fileprivate static func sortTileRecursive(_ nodes: inout [PackedNode], nodeSize: Int) {
+        let parentCount = (nodes.count + nodeSize - 1) / nodeSize
+        let sliceCount = Int(ceil(sqrt(Double(parentCount))))
+        guard sliceCount > 1 else { return }
+        nodes.sort { $0.minX + $0.maxX < $1.minX + $1.maxX }
+        let sliceSize = nodeSize * ((parentCount + sliceCount - 1) / sliceCount)
+        var start = 0
+        while start < nodes.count {
+            let end = min(start + sliceSize, nodes.count)
+            nodes[start..<end].sort { $0.minY + $0.maxY < $1.minY + $1.maxY }
+            start = end
+        }
+    }
+
+    fileprivate static func byteCount(nodeCount: Int, levelCount: Int) -> Int {
+        return (headerWords + levelCount) * MemoryLayout<Int64>.size
+            + nodeCount * (4 * MemoryLayout<Double>.size + MemoryLayout<Int32>.size)
+    }
+
+    fileprivate static func pack(nodes: [PackedNode], levelBounds: [Int], count: Int, nodeSize: Int) -> NSData {
+        let data = NSMutableData(length: byteCount(nodeCount: nodes.count, levelCount: levelBounds.count))!
+        let header = data.mutableBytes.assumingMemoryBound(to: Int64.self)
+        header[0] = magic
+        header[1] = Int64(nodeSize)
+        header[2] = Int64(count)
+        header[3] = Int64(nodes.count)
+        header[4] = Int64(levelBounds.count)
+        for (level, bound) in levelBounds.enumerated() {
+            header[headerWords + level] = Int64(bound)
+        }
+        let boxes = UnsafeMutableRawPointer(header + headerWords + levelBounds.count).assumingMemoryBound(to: Double.self)
+        let indices = UnsafeMutableRawPointer(boxes + 4 * nodes.count).assumingMemoryBound(to: Int32.self)
+        for (i, node) in nodes.enumerated() {
+            boxes[4 * i] = node.minX
+            boxes[4 * i + 1] = node.minY
+            boxes[4 * i + 2] = node.maxX
+            boxes[4 * i + 3] = node.maxY
+            indices[i] = node.index
+        }
+        return data
+    }
+
+    fileprivate static func sections(of data: NSData, nodeCount: Int, levelCount: Int) -> (UnsafePointer<Double>, UnsafePointer<Int32>) {
+        let header = data.bytes.assumingMemoryBound(to: Int64.self)
+        let boxes = UnsafeRawPointer(header + headerWords + levelCount).assumingMemoryBound(to: Double.self)
+        let indices = UnsafeRawPointer(boxes + 4 * nodeCount).assumingMemoryBound(to: Int32.self)
+        return (boxes, indices)
+    }
+}
+
+/// Planar box used while packing and querying; x is longitude, y is latitude.
+fileprivate struct PackedNode {
+    var minX: Double
+    var minY: Double
+    var maxX: Double
+    var maxY: Double
+    var index: Int32
+
+    mutating func extend(_ other: PackedNode) {
+        minX = min(minX, other.minX)
+        minY = min(minY, other.minY)
+        maxX = max(maxX, other.maxX)
+        maxY = max(maxY, other.maxY)
+    }
+
+    func intersects(_ other: PackedNode) -> Bool {
+        return minX <= other.maxX && maxX >= other.minX && minY <= other.maxY && maxY >= other.minY
+    }
+
+    func contains(_ other: PackedNode) -> Bool {
+        return other.minX >= minX && other.maxX <= maxX && other.minY >= minY && other.maxY <= maxY
+    }
+}
+
+/// Binary min-heap of nodes ordered by distance, for best-first k-nearest search.
+/// Also used by `PolylineSegmentIndex`.
+struct NodeQueue {
+
+    fileprivate var entries: [(node: Int, level: Int, distance: Double)] = []
+
+    mutating func push(node: Int, level: Int, distance: Double) {
+        entries.append((node: node, level: level, distance: distance))
+        var child = entries.count - 1
+        while child > 0 {
+            let parent = (child - 1) / 2
+            if entries[parent].distance <= entries[child].distance {
+                break
+            }
+            let swapped = entries[parent]
+            entries[parent] = entries[child]
+            entries[child] = swapped
+            child = parent
+        }
+    }
+
+    mutating func pop() -> (node: Int, level: Int, distance: Double)? {
+        guard let top = entries.first else { return nil }
+        let last = entries.removeLast()
+        if !entries.isEmpty {
+            entries[0] = last
+            var parent = 0
+            while true {
+                let left = 2 * parent + 1
+                let right = left + 1
+                var smallest = parent
+                if left < entries.count && entries[left].distance < entries[smallest].distance {
+                    smallest = left
+                }
+                if right < entries.count && entries[right].distance < entries[smallest].distance {
+                    smallest = right
+                }
+                if smallest == parent {
+                    break
+                }
+                let swapped = entries[parent]
+                entries[parent] = entries[smallest]
+                entries[smallest] = swapped
+                parent = smallest
+            }
+        }
+        return top
+    }
+}
@@ -0,0 +1,232 @@
+//
+//  HilbertSort.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+
+/// Reorders coordinate buffers along a Hilbert curve so that points close on the map are
+/// close in memory.
+///
+/// Keys are 32-bit Hilbert indices on a 65536 x 65536 grid stretched over the buffer's own
+/// enclosing box, computed branch-free in parallel chunks. The sort is a parallel, stable
+/// LSD radix sort (four 8-bit passes, per-chunk histograms), so equal keys keep their input
+/// order. Every entry point returns the permutation, `permutation[newIndex] == oldIndex`,
+/// so attribute arrays can follow with `HilbertSort.apply(_:to:)`.
+enum HilbertSort {
+
+    fileprivate static let gridMax: Double = 65535
+
+    // MARK: Keys
+
+    /// Hilbert index of every point, relative to `box` (points outside are clamped to its edges).
+    static func keys(latitudes: UnsafeBufferPointer<Double>, longitudes: UnsafeBufferPointer<Double>,
+                     in box: GeoBox, into result: UnsafeMutableBufferPointer<UInt32>) {
+        precondition(latitudes.count == longitudes.count && result.count >= latitudes.count, "HilbertSort: buffer size mismatch")
+        guard let lats = latitudes.baseAddress, let lons = longitudes.baseAddress, let out = result.baseAddress else { return }
+        let xScale = box.longitudeSpan > 0 ? gridMax / box.longitudeSpan : 0
+        let yScale = box.latitudeSpan > 0 ? gridMax / box.latitudeSpan : 0
+        let west = box.west, south = box.south
+        GeoBatch.concurrentChunks(count: latitudes.count) { range in
+            for i in range {
+                let x = min(max(GeoBox.wrappedOffset(lons[i] - west) * xScale, 0), gridMax)
+                let y = min(max((lats[i] - south) * yScale, 0), gridMax)
+                out[i] = index(x: UInt32(x), y: UInt32(y))
+            }
+        }
+    }
+
+    static func keys(for points: GeoCoordinateBuffer) -> [UInt32] {
+        var result = [UInt32](repeating: 0, count: points.count)
+        guard let box = GeoBox(containing: points) else { return result }
+        points.withUnsafeBuffers { lats, lons, _ in
+            result.withUnsafeMutableBufferPointer { keys(latitudes: lats, longitudes: lons, in: box, into: $0) }
+        }
+        return result
+    }
+
+    /// Hilbert index of a cell on the 16-bit grid, without the per-level rotation branches
+    /// (bit-parallel prefix scan of the curve state, as in Flatbush).
+    @inline(__always)
+    static func index(x: UInt32, y: UInt32) -> UInt32 {
+        var a = x ^ y
+        var b = 0xFFFF ^ a
+        var c = 0xFFFF ^ (x | y)
+        var d = x & (y ^ 0xFFFF)
+
+        var stateA = a | (b >> 1)
+        var stateB = (a >> 1) ^ a
+        var stateC = ((c >> 1) ^ (b & (d >> 1))) ^ c
+        var stateD = ((a & (c >> 1)) ^ (d >> 1)) ^ d
+
+        for shift: UInt32 in [2, 4] {
+            a = stateA; b = stateB; c = stateC; d = stateD
+            stateA = (a & (a >> shift)) ^ (b & (b >> shift))
+            stateB = (a & (b >> shift)) ^ (b & ((a ^ b) >> shift))
+            stateC ^= (a & (c >> shift)) ^ (b & (d >> shift))
+            stateD ^= (b & (c >> shift)) ^ ((a ^ b) & (d >> shift))
+        }
+
+        a = stateA; b = stateB; c = stateC; d = stateD
+        stateC ^= (a & (c >> 8)) ^ (b & (d >> 8))
+        stateD ^= (b & (c >> 8)) ^ ((a ^ b) & (d >> 8))
+
+        a = stateC ^ (stateC >> 1)
+        b = stateD ^ (stateD >> 1)
+        let i0 = x ^ y
+        let i1 = b | (0xFFFF ^ (i0 | a))
+        return (spread(i1) << 1) | spread(i0)
+    }
+
+    @inline(__always)
+    fileprivate static func spread(_ value: UInt32) -> UInt32 {
+        var x = value & 0xFFFF
+        x = (x | (x << 8)) & 0x00FF_00FF
+        x = (x | (x << 4)) & 0x0F0F_0F0F
+        x = (x | (x << 2)) & 0x3333_3333
+        x = (x | (x << 1)) & 0x5555_5555
+        return x
+    }
+
+    // MARK: Sorting
+
+    /// Stable ascending order of `keys`: `result[k]` is the index of the k-th smallest key.
+    static func sortedPermutation(keys: [UInt32]) -> [Int] {
+        let count = keys.count
+        guard count > 1 else { return Array(0..<count) }
+        precondition(count <= Int(Int32.max), "HilbertSort: too many elements")
+
+        var keyScratch = [UInt32](repeating: 0, count: 2 * count)
+        var indexScratch = [Int32](repeating: 0, count: 2 * count)
+        let workers = ProcessInfo.processInfo.activeProcessorCount
+        let chunk = max(65_536, (count + workers - 1) / workers)
+        let chunks = (count + chunk - 1) / chunk
+        var histograms = [Int](repeating: 0, count: chunks * 256)
+
+        var result = [Int](repeating: 0, count: count)
+        keyScratch.withUnsafeMutableBufferPointer { keyBuffer in
+            indexScratch.withUnsafeMutableBufferPointer { indexBuffer in
+                histograms.withUnsafeMutableBufferPointer { histogramBuffer in
+                    var sourceKeys = keyBuffer.baseAddress!, targetKeys = sourceKeys + count
+                    var sourceIndices = indexBuffer.baseAddress!, targetIndices = sourceIndices + count
+                    let counts = histogramBuffer.baseAddress!
+                    for i in 0..<count {
+                        sourceKeys[i] = keys[i]
+                        sourceIndices[i] = Int32(i)
+                    }
+
+                    for shift: UInt32 in [0, 8, 16, 24] {
+                        let (fromKeys, toKeys, fromIndices, toIndices) = (sourceKeys, targetKeys, sourceIndices, targetIndices)
+                        parallel(chunks) { c in
+                            let bucket = counts + c * 256
+                            for b in 0..<256 { bucket[b] = 0 }
+                            for i in (c * chunk)..<min((c + 1) * chunk, count) {
+                                bucket[Int((fromKeys[i] >> shift) & 0xFF)] += 1
+                            }
+                        }
+
+                        // Skip passes where every key has the same digit.
+                        var skip = false
+                        for digit in 0..<256 {
+                            var total = 0
+                            for c in 0..<chunks { total += counts[c * 256 + digit] }
+                            if total == count { skip = true }
+                        }
+                        if skip { continue }
+
+                        var offset = 0
+                        for digit in 0..<256 {
+                            for c in 0..<chunks {
+                                let n = counts[c * 256 + digit]
+                                counts[c * 256 + digit] = offset
+                                offset += n
+                            }
+                        }
+                        parallel(chunks) { c in
+                            let bucket = counts + c * 256
+                            for i in (c * chunk)..<min((c + 1) * chunk, count) {
+                                let key = fromKeys[i]
+                                let digit = Int((key >> shift) & 0xFF)
+                                let position = bucket[digit]
+                                bucket[digit] = position + 1
+                                toKeys[position] = key
+                                toIndices[position] = fromIndices[i]
+                            }
+                        }
+                        swap(&sourceKeys, &targetKeys)
+                        swap(&sourceIndices, &targetIndices)
+                    }
+
+                    for i in 0..<count {
+                        result[i] = Int(sourceIndices[i])
+                    }
+                }
+            }
+        }
+        return result
+    }
+
+    fileprivate static func parallel(_ chunks: Int, _ body: (Int) -> Void) {
+        if chunks == 1 {
+            body(0)
+        } else {
+            DispatchQueue.concurrentPerform(iterations: chunks, execute: body)
+        }
+    }
+
+    /// Hilbert order of `points`, without moving them.
+    static func permutation(for points: GeoCoordinateBuffer) -> [Int] {
+        return sortedPermutation(keys: keys(for: points))
+    }
+
+    // MARK: Applying
+
+    /// `values` rearranged into the order given by `permutation`.
+    static func apply<T>(_ permutation: [Int], to values: [T]) -> [T] {
+        precondition(permutation.count == values.count, "HilbertSort: permutation size mismatch")
+        return permutation.map { values[$0] }
+    }
+
+    /// Inverse of `permutation`: `inverse[oldIndex] == newIndex`, for remapping stored indices.
+    static func inverse(of permutation: [Int]) -> [Int] {
+        var result = [Int](repeating: 0, count: permutation.count)
+        for (newIndex, oldIndex) in permutation.enumerated() {
+            result[oldIndex] = newIndex
+        }
+        return result
+    }
+
+    fileprivate static func gather<T>(_ values: UnsafeMutableBufferPointer<T>, _ permutation: UnsafeBufferPointer<Int>) {
+        let source = Array(values)
+        source.withUnsafeBufferPointer { source in
+            let from = source.baseAddress!, to = values.baseAddress!, order = permutation.baseAddress!
+            GeoBatch.concurrentChunks(count: values.count) { range in
+                for i in range {
+                    to[i] = from[order[i]]
+                }
+            }
+        }
+    }
+}
+
+extension GeoCoordinateBuffer {
+
+    /// Reorders the vertices along a Hilbert curve in place and returns the permutation
+    /// (`permutation[newIndex] == oldIndex`). Only for point sets: it destroys polyline order.
+    @discardableResult
+    mutating func hilbertSort() -> [Int] {
+        let permutation = HilbertSort.permutation(for: self)
+        guard count > 1 else { return permutation }
+        permutation.withUnsafeBufferPointer { order in
+            withUnsafeMutableBuffers { lats, lons, alts in
+                HilbertSort.gather(lats, order)
+                HilbertSort.gather(lons, order)
+                HilbertSort.gather(alts, order)
+            }
+        }
+        return permutation
+    }
+}
@@ -0,0 +1,258 @@
+//
+//  IconAtlas.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import UIKit
+
+/// Where an icon sits in an atlas page, in pixels.
+struct IconAtlasFrame {
+    let page: Int
+    let rect: CGRect
+}
+
+/// Deduplicated, reference-counted marker icons packed into shared atlas pages.
+///
+/// Icons are identified by content: the bitmap is drawn into RGBA and hashed (FNV-1a over
+/// 64-bit words), with a byte compare on hash hits, so `UIImage(named:)` results, decoded
+/// downloads and re-rendered copies of the same picture all map to one shared `UIImage`.
+/// Memory therefore scales with distinct icons, not markers. Each distinct icon also gets a
+/// frame in a `pageSize` page, allocated with a skyline packer; `pageImage(_:)` renders a
+/// page for drawing many icons from one texture.
+///
+/// Main thread only. Release icons that are no longer used by any marker; a page's space
+/// is reclaimed once all its icons are released.
+final class IconAtlas {
+
+    static let shared = IconAtlas()
+
+    /// Page edge in pixels.
+    let pageSize: Int
+    /// Empty pixels around every icon, so filtering never bleeds into neighbors.
+    let padding = 1
+
+    fileprivate final class Icon {
+        let image: UIImage
+        let pixels: Data
+        let frame: IconAtlasFrame
+        var references = 0
+
+        init(image: UIImage, pixels: Data, frame: IconAtlasFrame) {
+            self.image = image
+            self.pixels = pixels
+            self.frame = frame
+        }
+    }
+
+    fileprivate struct Page {
+        var packer: SkylinePacker
+        var icons = 0
+        var image: UIImage?
+    }
+
+    fileprivate var iconsByHash: [UInt64: [Icon]] = [:]
+    fileprivate var iconsByImage: [ObjectIdentifier: (hash: UInt64, icon: Icon)] = [:]
+    fileprivate var pages: [Page] = []
+
+    init(pageSize: Int = 2048) {
+        self.pageSize = pageSize
+    }
+
+    var iconCount: Int {
+        return iconsByImage.count
+    }
+
+    var pageCount: Int {
+        return pages.count
+    }
+
+    // MARK: Icons
+
+    /// The shared icon for `image`'s content, retained once more. Assign the result to
+    /// `NMAMapMarker.icon` instead of `image`.
+    func icon(for image: UIImage) -> UIImage {
+        if let known = iconsByImage[ObjectIdentifier(image)] {
+            known.icon.references += 1
+            return image
+        }
+        guard let bitmap = IconAtlas.rgbaPixels(of: image) else { return image }
+        let pixels = bitmap.pixels
+        let hash = IconAtlas.hash(pixels)
+        if let match = iconsByHash[hash]?.first(where: { $0.pixels == pixels && Int($0.frame.rect.width) == bitmap.width && $0.image.scale == image.scale }) {
+            match.references += 1
+            return match.image
+        }
+
+        let frame = allocate(width: bitmap.width, height: bitmap.height)
+        let icon = Icon(image: image, pixels: pixels, frame: frame)
+        icon.references = 1
+        iconsByHash[hash] = (iconsByHash[hash] ?? []) + [icon]
+        iconsByImage[ObjectIdentifier(image)] = (hash, icon)
+        pages[frame.page].icons += 1
+        pages[frame.page].image = nil
+        return image
+    }
+
+    /// Drops one reference to an icon returned by `icon(for:)`; other images are ignored.
+    func release(_ image: UIImage) {
+        guard let known = iconsByImage[ObjectIdentifier(image)] else { return }
+        known.icon.references -= 1
+        guard known.icon.references == 0 else { return }
+        iconsByImage[ObjectIdentifier(image)] = nil
+        let remaining = (iconsByHash[known.hash] ?? []).filter { $0 !== known.icon }
+        iconsByHash[known.hash] = remaining.isEmpty ? nil : remaining
+        let page = known.icon.frame.page
+        pages[page].icons -= 1
+        pages[page].image = nil
+        if pages[page].icons == 0 {
+            pages[page].packer = SkylinePacker(width: pageSize, height: pageSize)
+        }
+    }
+
+    /// Frame of a shared icon in its page.
+    func frame(of image: UIImage) -> IconAtlasFrame? {
+        return iconsByImage[ObjectIdentifier(image)]?.icon.frame
+    }
+
+    /// The page as one bitmap (built on first use after a change).
+    func pageImage(_ page: Int) -> UIImage? {
+        guard page >= 0 && page < pages.count else { return nil }
+        if let image = pages[page].image {
+            return image
+        }
+        UIGraphicsBeginImageContextWithOptions(CGSize(width: pageSize, height: pageSize), false, 1)
+        defer { UIGraphicsEndImageContext() }
+        for (_, entry) in iconsByImage where entry.icon.frame.page == page {
+            entry.icon.image.draw(in: entry.icon.frame.rect)
+        }
+        pages[page].image = UIGraphicsGetImageFromCurrentImageContext()
+        return pages[page].image
+    }
+
+    // MARK: Packing
+
+    fileprivate func allocate(width: Int, height: Int) -> IconAtlasFrame {
+        let paddedWidth = width + 2 * padding, paddedHeight = height + 2 * padding
+        precondition(paddedWidth <= pageSize && paddedHeight <= pageSize, "IconAtlas: icon larger than a page")
+        for page in 0..<pages.count {
+            if let origin = pages[page].packer.insert(width: paddedWidth, height: paddedHeight) {
+                return frame(page: page, origin: origin, width: width, height: height)
+            }
+        }
+        var packer = SkylinePacker(width: pageSize, height: pageSize)
+        let origin = packer.insert(width: paddedWidth, height: paddedHeight)!
+        pages.append(Page(packer: packer, icons: 0, image: nil))
+        return frame(page: pages.count - 1, origin: origin, width: width, height: height)
+    }
+
+    fileprivate func frame(page: Int, origin: (x: Int, y: Int), width: Int, height: Int) -> IconAtlasFrame {
+        return IconAtlasFrame(page: page, rect: CGRect(x: origin.x + padding, y: origin.y + padding, width: width, height: height))
+    }
+
+    // MARK: Content hash
+
+    fileprivate static func rgbaPixels(of image: UIImage) -> (pixels: Data, width: Int, height: Int)? {
+        guard let cgImage = image.cgImage else { return nil }
+        let width = cgImage.width, height = cgImage.height
+        var pixels = Data(count: width * height * 4)
+        let drawn = pixels.withUnsafeMutableBytes { (bytes: UnsafeMutablePointer<UInt8>) -> Bool in
+            guard let context = CGContext(data: bytes, width: width, height: height, bitsPerComponent: 8, bytesPerRow: width * 4,
+                                          space: CGColorSpaceCreateDeviceRGB(),
+                                          bitmapInfo: CGImageAlphaInfo.premultipliedLast.rawValue) else { return false }
+            context.draw(cgImage, in: CGRect(x: 0, y: 0, width: width, height: height))
+            return true
+        }
+        return drawn ? (pixels, width, height) : nil
+    }
+
+    fileprivate static func hash(_ pixels: Data) -> UInt64 {
+        return pixels.withUnsafeBytes { (bytes: UnsafePointer<UInt8>) -> UInt64 in
+            var hash: UInt64 = 0xcbf29ce484222325
+            let words = pixels.count / 8
+            let raw = UnsafeRawPointer(bytes)
+            for i in 0..<words {
+                hash = (hash ^ raw.load(fromByteOffset: i * 8, as: UInt64.self)) &* 0x100000001b3
+            }
+            for i in (words * 8)..<pixels.count {
+                hash = (hash ^ UInt64(bytes[i])) &* 0x100000001b3
+            }
+            return hash ^ UInt64(pixels.count)
+        }
+    }
+}
+
+extension NMAMapMarker {
+    /// Sets the icon through `atlas`, releasing the previous one.
+    func setIcon(_ image: UIImage, atlas: IconAtlas = .shared) {
+        let shared = atlas.icon(for: image)
+        if let old = icon {
+            atlas.release(old)
+        }
+        icon = shared
+    }
+}
+
+/// Skyline bottom-left rectangle packer: the top edge of the packed area is kept as a list
+/// of horizontal segments and each rectangle goes where its top ends lowest.
+struct SkylinePacker {
+
+    let width: Int
+    let height: Int
+    fileprivate var segments: [(x: Int, y: Int, width: Int)]
+
+    init(width: Int, height: Int) {
+        self.width = width
+        self.height = height
+        segments = [(x: 0, y: 0, width: width)]
+    }
+
+    /// Origin of a new `width` x `height` rectangle, or nil if it doesn't fit.
+    mutating func insert(width w: Int, height h: Int) -> (x: Int, y: Int)? {
+        var best: (index: Int, x: Int, y: Int)?
+        for i in 0..<segments.count {
+            let x = segments[i].x
+            guard x + w <= width else { break }
+            // Resting height over the segments the rectangle spans.
+            var y = 0, covered = 0, j = i
+            while covered < w {
+                y = max(y, segments[j].y)
+                covered += segments[j].width
+                j += 1
+            }
+            guard y + h <= height else { continue }
+            if best == nil || y < best!.y || (y == best!.y && x < best!.x) {
+                best = (i, x, y)
+            }
+        }
+        guard let placed = best else { return nil }
+
+        // Replace the covered span with the new top edge.
+        var index = placed.index
+        segments.insert((x: placed.x, y: placed.y + h, width: w), at: index)
+        index += 1
+        let end = placed.x + w
+        while index < segments.count && segments[index].x < end {
+            let segmentEnd = segments[index].x + segments[index].width
+            if segmentEnd <= end {
+                segments.remove(at: index)
+            } else {
+                segments[index] = (x: end, y: segments[index].y, width: segmentEnd - end)
+                break
+            }
+        }
+        // Merge neighbors at the same height.
+        var i = 0
+        while i + 1 < segments.count {
+            if segments[i].y == segments[i + 1].y {
+                segments[i].width += segments[i + 1].width
+                segments.remove(at: i + 1)
+            } else {
+                i += 1
+            }
+        }
+        return (placed.x, placed.y)
+    }
+}
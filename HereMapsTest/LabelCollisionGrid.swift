@@ -0,0 +1,238 @@
+//
+//  LabelCollisionGrid.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import UIKit
+
+/// Labels whose visibility changed in the last `LabelCollisionGrid.place(...)`.
+struct LabelPlacementChange {
+    let shown: [NMAMapMarker]
+    let hidden: [NMAMapMarker]
+
+    var isEmpty: Bool {
+        return shown.isEmpty && hidden.isEmpty
+    }
+}
+
+/// Screen-space decluttering of marker labels (`title`, or `textDescription` when there is
+/// no title).
+///
+/// Each frame the label positions are projected in one vDSP pass (`MercatorProjection`),
+/// labels on screen are ordered by priority (higher `zIndex` first, then closer to the
+/// viewport center) with the parallel radix sort from `HilbertSort`, and placed greedily
+/// into a uniform grid of `cellSize` cells; a label is dropped if it overlaps one placed
+/// before it. Only the labels in the cells a label covers are tested, so a frame is linear
+/// in the candidate count.
+///
+/// Placement is kept stable across small camera moves: labels shown in the previous frame
+/// win ties (same `zIndex`, same distance in whole points) against new ones, and new labels
+/// need an extra `hysteresis` margin around them.
+///
+/// The SDK decides how it draws marker titles; apply the result to whatever shows the
+/// labels (custom label markers, overlay views).
+final class LabelCollisionGrid {
+
+    let font: UIFont
+    let cellSize: Double
+    /// Extra points a label must keep from others to appear; shown labels don't need it.
+    let hysteresis: Double
+    /// Empty points around every label.
+    let padding: Double
+
+    fileprivate var markers: [NMAMapMarker?] = []
+    fileprivate var freeSlots: [Int] = []
+    fileprivate var slots: [ObjectIdentifier: Int] = [:]
+    fileprivate var latitudes: [Double] = []
+    fileprivate var longitudes: [Double] = []
+    fileprivate var widths: [Double] = []
+    fileprivate var heights: [Double] = []
+    /// Bottom center of the label relative to the marker's anchor point, in screen points
+    /// (the label sits on top of the icon).
+    fileprivate var offsetXs: [Double] = []
+    fileprivate var offsetYs: [Double] = []
+    fileprivate var shown: [Bool] = []
+
+    // Per-frame scratch, kept between frames to avoid reallocating.
+    fileprivate var xs: [Double] = []
+    fileprivate var ys: [Double] = []
+    fileprivate var cellHeads: [Int32] = []
+    fileprivate var entryNext: [Int32] = []
+    fileprivate var entryLabel: [Int32] = []
+
+    init(font: UIFont = UIFont.systemFont(ofSize: 12), cellSize: Double = 64, hysteresis: Double = 6, padding: Double = 2) {
+        self.font = font
+        self.cellSize = cellSize
+        self.hysteresis = hysteresis
+        self.padding = padding
+    }
+
+    var count: Int {
+        return slots.count
+    }
+
+    // MARK: Labels
+
+    /// Adds or re-measures the marker's label. Call again after changing its title, icon or
+    /// `anchorOffset`.
+    func add(_ marker: NMAMapMarker) {
+        let text = marker.title ?? marker.textDescription ?? ""
+        let size = (text as NSString).size(attributes: [NSFontAttributeName: font])
+        let slot: Int
+        if let existing = slots[ObjectIdentifier(marker)] {
+            slot = existing
+        } else if let free = freeSlots.popLast() {
+            slot = free
+            markers[slot] = marker
+            shown[slot] = false
+        } else {
+            slot = markers.count
+            markers.append(marker)
+            latitudes.append(0)
+            longitudes.append(0)
+            widths.append(0)
+            heights.append(0)
+            offsetXs.append(0)
+            offsetYs.append(0)
+            shown.append(false)
+        }
+        slots[ObjectIdentifier(marker)] = slot
+        latitudes[slot] = marker.coordinates.latitude
+        longitudes[slot] = marker.coordinates.longitude
+        widths[slot] = text.isEmpty ? 0 : Double(ceil(size.width))
+        heights[slot] = text.isEmpty ? 0 : Double(ceil(size.height))
+        // The icon is centered on the anchor, then moved by `anchorOffset`.
+        offsetXs[slot] = Double(marker.anchorOffset.x)
+        offsetYs[slot] = Double(marker.anchorOffset.y) - Double(marker.icon?.size.height ?? 0) / 2
+    }
+
+    /// Picks up a new marker position.
+    func move(_ marker: NMAMapMarker) {
+        guard let slot = slots[ObjectIdentifier(marker)] else { return }
+        latitudes[slot] = marker.coordinates.latitude
+        longitudes[slot] = marker.coordinates.longitude
+    }
+
+    func remove(_ marker: NMAMapMarker) {
+        guard let slot = slots.removeValue(forKey: ObjectIdentifier(marker)) else { return }
+        markers[slot] = nil
+        widths[slot] = 0
+        shown[slot] = false
+        freeSlots.append(slot)
+    }
+
+    func isShown(_ marker: NMAMapMarker) -> Bool {
+        guard let slot = slots[ObjectIdentifier(marker)] else { return false }
+        return shown[slot]
+    }
+
+    // MARK: Placement
+
+    /// Places the labels for the current camera and returns what changed since last time.
+    func place(projection: MercatorProjection, viewport: CGRect) -> LabelPlacementChange {
+        let total = markers.count
+        if xs.count != total {
+            xs = [Double](repeating: 0, count: total)
+            ys = [Double](repeating: 0, count: total)
+        }
+        latitudes.withUnsafeBufferPointer { lats in
+            longitudes.withUnsafeBufferPointer { lons in
+                xs.withUnsafeMutableBufferPointer { outX in
+                    ys.withUnsafeMutableBufferPointer { outY in
+                        projection.project(latitudes: lats, longitudes: lons, x: outX, y: outY)
+                    }
+                }
+            }
+        }
+        // From here on xs and ys are the labels' bottom centers.
+        for slot in 0..<total {
+            xs[slot] += offsetXs[slot]
+            ys[slot] += offsetYs[slot]
+        }
+
+        // Candidates on screen, keyed by priority.
+        let minX = Double(viewport.minX), maxX = Double(viewport.maxX)
+        let minY = Double(viewport.minY), maxY = Double(viewport.maxY)
+        let centerX = Double(viewport.midX), centerY = Double(viewport.midY)
+        var candidates = [Int]()
+        var keys = [UInt32]()
+        for slot in 0..<total where widths[slot] > 0 {
+            let x = xs[slot], y = ys[slot]
+            guard x + widths[slot] / 2 >= minX && x - widths[slot] / 2 <= maxX && y >= minY && y - heights[slot] <= maxY else { continue }
+            let zIndex = UInt32(min(markers[slot]!.zIndex, 255))
+            // Distance in whole points, so being shown only breaks ties below it.
+            let distance = UInt32(min((x - centerX) * (x - centerX) + (y - centerY) * (y - centerY), 4_000_000).squareRoot())
+            let isNew: UInt32 = shown[slot] ? 0 : 1
+            keys.append((255 - zIndex) << 24 | distance << 1 | isNew)
+            candidates.append(slot)
+        }
+        let order = HilbertSort.sortedPermutation(keys: keys)
+
+        let columns = max(Int(ceil((maxX - minX) / cellSize)), 1), rows = max(Int(ceil((maxY - minY) / cellSize)), 1)
+        cellHeads = [Int32](repeating: -1, count: columns * rows)
+        entryNext.removeAll(keepingCapacity: true)
+        entryLabel.removeAll(keepingCapacity: true)
+        var placed = [Bool](repeating: false, count: total)
+        for position in order {
+            let slot = candidates[position]
+            let margin = padding + (shown[slot] ? 0 : hysteresis)
+            let halfWidth = widths[slot] / 2
+            let left = xs[slot] - halfWidth - margin, right = xs[slot] + halfWidth + margin
+            let bottom = ys[slot] + margin, top = bottom - heights[slot] - 2 * margin
+            let firstColumn = min(max(Int((left - minX) / cellSize), 0), columns - 1)
+            let lastColumn = min(max(Int((right - minX) / cellSize), 0), columns - 1)
+            let firstRow = min(max(Int((top - minY) / cellSize), 0), rows - 1)
+            let lastRow = min(max(Int((bottom - minY) / cellSize), 0), rows - 1)
+
+            var blocked = false
+            search: for row in firstRow...lastRow {
+                for column in firstColumn...lastColumn {
+                    var entry = cellHeads[row * columns + column]
+                    while entry >= 0 {
+                        let other = Int(entryLabel[Int(entry)])
+                        let otherHalf = widths[other] / 2 + padding
+                        let otherBottom = ys[other] + padding
+                        if left < xs[other] + otherHalf && right > xs[other] - otherHalf &&
+                            top < otherBottom && bottom > otherBottom - heights[other] - 2 * padding {
+                            blocked = true
+                            break search
+                        }
+                        entry = entryNext[Int(entry)]
+                    }
+                }
+            }
+            guard !blocked else { continue }
+            placed[slot] = true
+            for row in firstRow...lastRow {
+                for column in firstColumn...lastColumn {
+                    entryNext.append(cellHeads[row * columns + column])
+                    entryLabel.append(Int32(slot))
+                    cellHeads[row * columns + column] = Int32(entryNext.count - 1)
+                }
+            }
+        }
+
+        var nowShown = [NMAMapMarker]()
+        var nowHidden = [NMAMapMarker]()
+        for slot in 0..<total where placed[slot] != shown[slot] {
+            shown[slot] = placed[slot]
+            guard let marker = markers[slot] else { continue }
+            if placed[slot] {
+                nowShown.append(marker)
+            } else {
+                nowHidden.append(marker)
+            }
+        }
+        return LabelPlacementChange(shown: nowShown, hidden: nowHidden)
+    }
+
+    func place(_ mapView: NMAMapView) -> LabelPlacementChange {
+        guard let projection = MercatorProjection(mapView: mapView) else {
+            return LabelPlacementChange(shown: [], hidden: [])
+        }
+        return place(projection: projection, viewport: mapView.bounds)
+    }
+}
@@ -0,0 +1,384 @@
+//
+//  MapHitTestIndex.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import UIKit
+
+/// Maintained spatial index for picking map objects, a stand-in for `NMAMapView.objects(at:)`
+/// and `visibleObjects(at:)` which test every object on the map.
+///
+/// Extents are kept in normalized Web Mercator in a loose quadtree keyed by `GeoCellId`: an
+/// entry sits in the cell at the deepest level whose size still covers it, in the cell of its
+/// center, and each cell's bounds are grown by half a cell. Per-cell subtree counts let a
+/// query descend only into non-empty cells near the tap, so picking costs O(depth) plus the
+/// candidates found. Polylines and polygon outlines are indexed per run of
+/// `MapHitTestIndex.segmentsPerEntry` segments, so a long route only tests the segments
+/// near the tap.
+///
+/// Exact tests use the same tolerances the map draws with: marker icon bounds, half the
+/// line width of polylines, polygon and circle outlines, and the circle radius. The index
+/// does not observe the objects; call `update(_:)` after moving or editing one.
+final class MapHitTestIndex {
+
+    static let maxLevel = 24
+    static let segmentsPerEntry = 32
+
+    fileprivate enum Kind {
+        case marker(width: Double, height: Double, offsetX: Double, offsetY: Double)
+        case polyline(halfWidth: Double)
+        case polygon(halfWidth: Double)
+        case circle(radius: Double, halfWidth: Double)
+    }
+
+    fileprivate struct Shape {
+        let object: NMAMapObject
+        let kind: Kind
+        /// Mercator vertices; x is kept continuous across the date line.
+        let xs: [Double]
+        let ys: [Double]
+        var entries: [Int32]
+    }
+
+    fileprivate struct Entry {
+        var shape: Int32
+        /// First vertex of the segment run, or -1 for the whole shape.
+        var first: Int32
+        /// Box in the [0, 1) world; add `shift` to get back to the shape's vertex x.
+        var minX, minY, maxX, maxY: Double
+        var shift: Double
+        var cell: UInt64
+    }
+
+    fileprivate var shapes: [Shape?] = []
+    fileprivate var freeShapes: [Int] = []
+    fileprivate var slots: [ObjectIdentifier: Int] = [:]
+    fileprivate var entries: [Entry] = []
+    fileprivate var freeEntries: [Int] = []
+    /// Entries stored in each cell.
+    fileprivate var cells: [UInt64: [Int32]] = [:]
+    /// Entries stored in each cell and its descendants.
+    fileprivate var subtreeCounts: [UInt64: Int32] = [:]
+    /// Largest marker half-extent in points, added to the query radius (never shrinks).
+    fileprivate var markerReach: Double = 0
+    /// Largest line half-width in points (polylines, outlines), likewise added to the radius.
+    fileprivate var lineReach: Double = 0
+
+    var count: Int {
+        return slots.count
+    }
+
+    // MARK: Maintenance
+
+    /// Indexes `object` with its current geometry. Containers add their children.
+    func add(_ object: NMAMapObject) {
+        if let container = object as? NMAMapContainer {
+            container.mapObjects.forEach { add($0) }
+            return
+        }
+        guard slots[ObjectIdentifier(object)] == nil, var shape = MapHitTestIndex.shape(for: object) else { return }
+        let slot = freeShapes.popLast() ?? shapes.count
+        if slot == shapes.count {
+            shapes.append(nil)
+        }
+        if case let .marker(width, height, offsetX, offsetY) = shape.kind {
+            markerReach = max(markerReach, max(width / 2 + abs(offsetX), height / 2 + abs(offsetY)))
+        }
+        switch shape.kind {
+        case let .polyline(halfWidth), let .polygon(halfWidth), let .circle(_, halfWidth):
+            lineReach = max(lineReach, halfWidth)
+        case .marker:
+            break
+        }
+
+        let vertexCount = shape.xs.count
+        switch shape.kind {
+        case .polyline, .polygon:
+            let closed: Bool
+            if case .polygon = shape.kind { closed = true } else { closed = false }
+            let segmentCount = closed ? vertexCount : vertexCount - 1
+            var first = 0
+            repeat {
+                let last = min(first + MapHitTestIndex.segmentsPerEntry, max(segmentCount, 0))
+                var minX = Double.infinity, minY = Double.infinity, maxX = -Double.infinity, maxY = -Double.infinity
+                for v in first...last {
+                    let k = v % vertexCount
+                    minX = min(minX, shape.xs[k]); maxX = max(maxX, shape.xs[k])
+                    minY = min(minY, shape.ys[k]); maxY = max(maxY, shape.ys[k])
+                }
+                shape.entries.append(insertEntry(shape: slot, first: first, minX: minX, minY: minY, maxX: maxX, maxY: maxY))
+                first = last
+            } while first < segmentCount
+            if closed && vertexCount > 2 {
+                // Interior, for taps inside the polygon away from the outline.
+                shape.entries.append(insertEntry(shape: slot, first: -1, minX: shape.xs.min()!, minY: shape.ys.min()!,
+                                                 maxX: shape.xs.max()!, maxY: shape.ys.max()!))
+            }
+        case let .circle(radius, _):
+            shape.entries.append(insertEntry(shape: slot, first: -1, minX: shape.xs[0] - radius, minY: shape.ys[0] - radius,
+                                             maxX: shape.xs[0] + radius, maxY: shape.ys[0] + radius))
+        case .marker:
+            shape.entries.append(insertEntry(shape: slot, first: -1, minX: shape.xs[0], minY: shape.ys[0],
+                                             maxX: shape.xs[0], maxY: shape.ys[0]))
+        }
+        shapes[slot] = shape
+        slots[ObjectIdentifier(object)] = slot
+    }
+
+    func remove(_ object: NMAMapObject) {
+        if let container = object as? NMAMapContainer {
+            container.mapObjects.forEach { remove($0) }
+            return
+        }
+        guard let slot = slots.removeValue(forKey: ObjectIdentifier(object)), let shape = shapes[slot] else { return }
+        for entry in shape.entries {
+            removeEntry(Int(entry))
+        }
+        shapes[slot] = nil
+        freeShapes.append(slot)
+    }
+
+    /// Re-indexes `object` after its position, geometry, icon or line width changed.
+    func update(_ object: NMAMapObject) {
+        remove(object)
+        add(object)
+    }
+
+    func removeAll() {
+        shapes.removeAll()
+        freeShapes.removeAll()
+        slots.removeAll()
+        entries.removeAll()
+        freeEntries.removeAll()
+        cells.removeAll()
+        subtreeCounts.removeAll()
+        markerReach = 0
+        lineReach = 0
+    }
+
+    // MARK: Picking
+
+    /// Objects under `point`, topmost (highest `zIndex`) first. `tolerance` widens every
+    /// object's hit area by that many points.
+    func objects(at point: CGPoint, projection: MercatorProjection, tolerance: CGFloat = 0) -> [NMAMapObject] {
+        let scale = projection.scale
+        let geo = projection.geoCoordinates(at: point)
+        let px = MercatorProjection.mercatorX(longitude: geo.longitude)
+        let py = MercatorProjection.mercatorY(latitude: geo.latitude)
+        let slack = Double(tolerance) / scale
+        let reach = slack + max(markerReach, lineReach) / scale
+
+        var hits = Set<Int>()
+        // The same spot one world to the west and east, for entries across the date line.
+        for shift in [-1.0, 0, 1] {
+            visit(GeoCellId(i: 0, j: 0, level: 0), x: px + shift, y: py, reach: reach) { index in
+                let entry = entries[index]
+                let shape = Int(entry.shape)
+                if !hits.contains(shape) && hitTest(entry, x: px + shift, y: py, slack: slack, scale: scale) {
+                    hits.insert(shape)
+                }
+            }
+        }
+        return hits.map { shapes[$0]!.object }.sorted { $0.zIndex > $1.zIndex }
+    }
+
+    func objects(at point: CGPoint, in mapView: NMAMapView, tolerance: CGFloat = 0) -> [NMAMapObject] {
+        guard let projection = MercatorProjection(mapView: mapView) else { return [] }
+        return objects(at: point, projection: projection, tolerance: tolerance)
+    }
+
+    /// Like `objects(at:projection:tolerance:)`, skipping hidden objects and objects
+    /// hidden at `zoomLevel`.
+    func visibleObjects(at point: CGPoint, projection: MercatorProjection, zoomLevel: Float, tolerance: CGFloat = 0) -> [NMAMapObject] {
+        return objects(at: point, projection: projection, tolerance: tolerance).filter {
+            $0.isVisible && $0.isVisible(atZoomLevel: zoomLevel)
+        }
+    }
+
+    func visibleObjects(at point: CGPoint, in mapView: NMAMapView, tolerance: CGFloat = 0) -> [NMAMapObject] {
+        guard let projection = MercatorProjection(mapView: mapView) else { return [] }
+        return visibleObjects(at: point, projection: projection, zoomLevel: mapView.zoomLevel, tolerance: tolerance)
+    }
+
+    // MARK: Quadtree
+
+    fileprivate func insertEntry(shape: Int, first: Int, minX: Double, minY: Double, maxX: Double, maxY: Double) -> Int32 {
+        let size = max(maxX - minX, maxY - minY)
+        let level = size > 0 ? min(MapHitTestIndex.maxLevel, max(0, Int(floor(-log2(size))))) : MapHitTestIndex.maxLevel
+        let n = Double(1 << level)
+        // Shift so the center lies in the [0, 1) world.
+        let centerX = (minX + maxX) / 2
+        let shift = floor(centerX)
+        let i = UInt64(min(max((centerX - shift) * n, 0), n - 1))
+        let j = UInt64(min(max((minY + maxY) / 2 * n, 0), n - 1))
+        let cell = GeoCellId(i: i, j: j, level: level)
+
+        let entry = Entry(shape: Int32(shape), first: Int32(first), minX: minX - shift, minY: minY,
+                          maxX: maxX - shift, maxY: maxY, shift: shift, cell: cell.rawValue)
+        let index: Int
+        if let free = freeEntries.popLast() {
+            index = free
+            entries[index] = entry
+        } else {
+            index = entries.count
+            entries.append(entry)
+        }
+
+        var list = cells[cell.rawValue] ?? []
+        list.append(Int32(index))
+        cells[cell.rawValue] = list
+        for ancestor in 0...level {
+            let key = cell.parent(level: ancestor).rawValue
+            subtreeCounts[key] = (subtreeCounts[key] ?? 0) + 1
+        }
+        return Int32(index)
+    }
+
+    fileprivate func removeEntry(_ index: Int) {
+        let cell = GeoCellId(rawValue: entries[index].cell)
+        if var list = cells[cell.rawValue], let position = list.index(of: Int32(index)) {
+            list.remove(at: position)
+            cells[cell.rawValue] = list.isEmpty ? nil : list
+        }
+        for ancestor in 0...cell.level {
+            let key = cell.parent(level: ancestor).rawValue
+            let remaining = (subtreeCounts[key] ?? 1) - 1
+            subtreeCounts[key] = remaining > 0 ? remaining : nil
+        }
+        freeEntries.append(index)
+    }
+
+    /// Calls `body` for the entries of every non-empty cell whose loose bounds, grown by
+    /// `reach`, contain (x, y).
+    fileprivate func visit(_ cell: GeoCellId, x: Double, y: Double, reach: Double, _ body: (Int) -> Void) {
+        guard subtreeCounts[cell.rawValue] != nil else { return }
+        let level = cell.level
+        let size = 1 / Double(1 << level)
+        let (i, j) = cell.position
+        let margin = size / 2 + reach
+        guard x >= Double(i) * size - margin && x <= Double(i + 1) * size + margin &&
+            y >= Double(j) * size - margin && y <= Double(j + 1) * size + margin else { return }
+
+        if let list = cells[cell.rawValue] {
+            for index in list {
+                body(Int(index))
+            }
+        }
+        if level < MapHitTestIndex.maxLevel {
+            for k in 0..<4 {
+                visit(cell.child(k), x: x, y: y, reach: reach, body)
+            }
+        }
+    }
+
+    // MARK: Exact tests
+
+    fileprivate func hitTest(_ entry: Entry, x px: Double, y py: Double, slack: Double, scale: Double) -> Bool {
+        guard let shape = shapes[Int(entry.shape)] else { return false }
+        let vx = px + entry.shift
+        switch shape.kind {
+        case let .marker(width, height, offsetX, offsetY):
+            let dx = px - (entry.minX + offsetX / scale)
+            let dy = py - (entry.minY + offsetY / scale)
+            return abs(dx) <= width / 2 / scale + slack && abs(dy) <= height / 2 / scale + slack
+        case let .circle(radius, halfWidth):
+            let dx = px - (entry.minX + entry.maxX) / 2
+            let dy = py - (entry.minY + entry.maxY) / 2
+            return sqrt(dx * dx + dy * dy) <= radius + halfWidth / scale + slack
+        case let .polyline(halfWidth):
+            guard entry.first >= 0 else { return false }
+            return nearSegments(shape, from: Int(entry.first), x: vx, y: py, within: halfWidth / scale + slack)
+        case let .polygon(halfWidth):
+            if entry.first >= 0 {
+                return nearSegments(shape, from: Int(entry.first), x: vx, y: py, within: halfWidth / scale + slack)
+            }
+            return entry.minX - slack <= px && px <= entry.maxX + slack && MapHitTestIndex.ring(shape, contains: vx, py)
+        }
+    }
+
+    fileprivate func nearSegments(_ shape: Shape, from first: Int, x: Double, y: Double, within distance: Double) -> Bool {
+        let count = shape.xs.count
+        if count == 1 {
+            return hypot(x - shape.xs[0], y - shape.ys[0]) <= distance
+        }
+        let closed: Bool
+        if case .polygon = shape.kind { closed = true } else { closed = false }
+        let segmentCount = closed ? count : count - 1
+        let squared = distance * distance
+        for s in first..<min(first + MapHitTestIndex.segmentsPerEntry, segmentCount) {
+            let x0 = shape.xs[s], y0 = shape.ys[s]
+            let x1 = shape.xs[(s + 1) % count], y1 = shape.ys[(s + 1) % count]
+            let dx = x1 - x0, dy = y1 - y0
+            let lengthSquared = dx * dx + dy * dy
+            let t = lengthSquared > 0 ? min(max(((x - x0) * dx + (y - y0) * dy) / lengthSquared, 0), 1) : 0
+            let ex = x0 + t * dx - x, ey = y0 + t * dy - y
+            if ex * ex + ey * ey <= squared {
+                return true
+            }
+        }
+        return false
+    }
+
+    /// Even-odd rule.
+    fileprivate static func ring(_ shape: Shape, contains x: Double, _ y: Double) -> Bool {
+        var inside = false
+        var previous = shape.xs.count - 1
+        for current in 0..<shape.xs.count {
+            let xi = shape.xs[current], yi = shape.ys[current]
+            let xj = shape.xs[previous], yj = shape.ys[previous]
+            if (yi > y) != (yj > y) && x < (xj - xi) * (y - yi) / (yj - yi) + xi {
+                inside = !inside
+            }
+            previous = current
+        }
+        return inside
+    }
+
+    // MARK: Geometry capture
+
+    fileprivate static func shape(for object: NMAMapObject) -> Shape? {
+        switch object {
+        case let marker as NMAMapMarker:
+            let size = marker.icon?.size ?? CGSize(width: 32, height: 32)
+            let kind = Kind.marker(width: Double(size.width), height: Double(size.height),
+                                   offsetX: Double(marker.anchorOffset.x), offsetY: Double(marker.anchorOffset.y))
+            return Shape(object: object, kind: kind,
+                         xs: [MercatorProjection.mercatorX(longitude: marker.coordinates.longitude)],
+                         ys: [MercatorProjection.mercatorY(latitude: marker.coordinates.latitude)], entries: [])
+        case let circle as NMAMapCircle:
+            // Mercator stretches lengths by 1 / cos(latitude).
+            let metersPerUnit = 2 * Double.pi * GeoBatch.earthRadius * cos(circle.center.latitude * GeoBatch.degreesToRadians)
+            let kind = Kind.circle(radius: circle.radius / max(metersPerUnit, 1), halfWidth: Double(circle.lineWidth) / 2)
+            return Shape(object: object, kind: kind,
+                         xs: [MercatorProjection.mercatorX(longitude: circle.center.longitude)],
+                         ys: [MercatorProjection.mercatorY(latitude: circle.center.latitude)], entries: [])
+        case let polyline as NMAMapPolyline:
+            let (xs, ys) = mercatorVertices(polyline.vertices)
+            return xs.isEmpty ? nil : Shape(object: object, kind: .polyline(halfWidth: Double(polyline.lineWidth) / 2), xs: xs, ys: ys, entries: [])
+        case let polygon as NMAMapPolygon:
+            let (xs, ys) = mercatorVertices(polygon.vertices)
+            return xs.isEmpty ? nil : Shape(object: object, kind: .polygon(halfWidth: Double(polygon.lineWidth) / 2), xs: xs, ys: ys, entries: [])
+        default:
+            return nil
+        }
+    }
+
+    /// Mercator vertices with x unwrapped, so consecutive vertices never jump across the date line.
+    fileprivate static func mercatorVertices(_ vertices: [NMAGeoCoordinates]) -> ([Double], [Double]) {
+        var xs = [Double](), ys = [Double]()
+        xs.reserveCapacity(vertices.count)
+        ys.reserveCapacity(vertices.count)
+        for vertex in vertices {
+            var x = MercatorProjection.mercatorX(longitude: vertex.longitude)
+            if let previous = xs.last {
+                x -= (x - previous).rounded()
+            }
+            xs.append(x)
+            ys.append(MercatorProjection.mercatorY(latitude: vertex.latitude))
+        }
+        return (xs, ys)
+    }
+}
@@ -0,0 +1,239 @@
+//
+//  MapSceneStore.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+
+/// Slot of an object in a `MapSceneStore`. Only valid until the object is removed; slots are reused.
+struct MapSceneHandle {
+    let type: NMAMapObjectType
+    let slot: Int
+}
+
+extension MapSceneHandle: Hashable {
+    var hashValue: Int {
+        return slot &* 8 &+ Int(type.rawValue)
+    }
+
+    static func == (lhs: MapSceneHandle, rhs: MapSceneHandle) -> Bool {
+        return lhs.type == rhs.type && lhs.slot == rhs.slot
+    }
+}
+
+/// Flat mirror of a map object hierarchy.
+///
+/// `NMAMapContainer.mapObjects` copies an NSArray on every call and parents are only
+/// reachable through weak `parent` pointers, so walking a container tree per frame is
+/// slow. The store keeps one set of parallel arrays per `NMAMapObjectType` (objects, parent
+/// container slot, dirty flag) and a list of dirty handles, so per-frame work visits only
+/// the objects that changed. Add and remove reuse free slots and are O(1) amortized
+/// (removing a container also removes its subtree).
+///
+/// Objects go through the store for container edits so the SDK hierarchy stays in sync;
+/// adding root objects to an `NMAMapView` is still up to the caller.
+final class MapSceneStore {
+
+    fileprivate struct TypeTable {
+        var objects: [NMAMapObject?] = []
+        /// Slot in the container table, or -1 for root objects.
+        var parents: [Int32] = []
+        /// Position in the parent's child list, for O(1) unlinking.
+        var childPositions: [Int32] = []
+        var dirty: [Bool] = []
+        var freeSlots: [Int] = []
+        var liveCount = 0
+
+        mutating func insert(_ object: NMAMapObject, parent: Int32) -> Int {
+            liveCount += 1
+            if let slot = freeSlots.popLast() {
+                objects[slot] = object
+                parents[slot] = parent
+                dirty[slot] = false
+                return slot
+            }
+            objects.append(object)
+            parents.append(parent)
+            childPositions.append(-1)
+            dirty.append(false)
+            return objects.count - 1
+        }
+
+        mutating func free(_ slot: Int) {
+            objects[slot] = nil
+            parents[slot] = -1
+            childPositions[slot] = -1
+            dirty[slot] = false
+            freeSlots.append(slot)
+            liveCount -= 1
+        }
+    }
+
+    fileprivate static let typeCount = Int(NMAMapObjectType.unknown.rawValue) + 1
+
+    fileprivate var tables = [TypeTable](repeating: TypeTable(), count: MapSceneStore.typeCount)
+    /// Child handles per container slot.
+    fileprivate var children: [[MapSceneHandle]] = []
+    fileprivate var handles: [ObjectIdentifier: MapSceneHandle] = [:]
+    fileprivate var dirtyHandles: [MapSceneHandle] = []
+
+    var count: Int {
+        return handles.count
+    }
+
+    func count(of type: NMAMapObjectType) -> Int {
+        return tables[Int(type.rawValue)].liveCount
+    }
+
+    // MARK: Hierarchy
+
+    /// Registers `object` under `parent` (root if nil) and adds it to the SDK container.
+    /// A container brings its existing children along. New objects start dirty.
+    @discardableResult
+    func add(_ object: NMAMapObject, to parent: NMAMapContainer? = nil) -> MapSceneHandle {
+        precondition(handles[ObjectIdentifier(object)] == nil, "MapSceneStore: object already added")
+        var parentSlot: Int32 = -1
+        if let parent = parent {
+            guard let parentHandle = handles[ObjectIdentifier(parent)] else {
+                preconditionFailure("MapSceneStore: parent container is not in the store")
+            }
+            parentSlot = Int32(parentHandle.slot)
+            parent.add(object)
+        }
+        return register(object, parentSlot: parentSlot)
+    }
+
+    fileprivate func register(_ object: NMAMapObject, parentSlot: Int32) -> MapSceneHandle {
+        let type = object.type
+        let slot = tables[Int(type.rawValue)].insert(object, parent: parentSlot)
+        let handle = MapSceneHandle(type: type, slot: slot)
+        handles[ObjectIdentifier(object)] = handle
+
+        if parentSlot >= 0 {
+            let siblings = Int(parentSlot)
+            tables[Int(type.rawValue)].childPositions[slot] = Int32(children[siblings].count)
+            children[siblings].append(handle)
+        }
+        if let container = object as? NMAMapContainer {
+            while children.count <= slot {
+                children.append([])
+            }
+            children[slot] = []
+            // One NSArray copy per container, at import time only.
+            for child in container.mapObjects {
+                _ = register(child, parentSlot: Int32(slot))
+            }
+        }
+        markDirty(handle)
+        return handle
+    }
+
+    /// Removes `object` and its subtree from the store and from its SDK container.
+    func remove(_ object: NMAMapObject) {
+        guard let handle = handles[ObjectIdentifier(object)] else { return }
+        let parentSlot = tables[Int(handle.type.rawValue)].parents[handle.slot]
+        if parentSlot >= 0, let parent = tables[Int(NMAMapObjectType.container.rawValue)].objects[Int(parentSlot)] as? NMAMapContainer {
+            unlink(handle, from: Int(parentSlot))
+            parent.remove(object)
+        }
+        unregister(handle)
+    }
+
+    fileprivate func unlink(_ handle: MapSceneHandle, from parentSlot: Int) {
+        let position = Int(tables[Int(handle.type.rawValue)].childPositions[handle.slot])
+        let last = children[parentSlot].removeLast()
+        if position < children[parentSlot].count {
+            children[parentSlot][position] = last
+            tables[Int(last.type.rawValue)].childPositions[last.slot] = Int32(position)
+        }
+    }
+
+    fileprivate func unregister(_ handle: MapSceneHandle) {
+        if handle.type == .container {
+            for child in children[handle.slot] {
+                unregister(child)
+            }
+            children[handle.slot] = []
+        }
+        if let object = tables[Int(handle.type.rawValue)].objects[handle.slot] {
+            handles[ObjectIdentifier(object)] = nil
+        }
+        tables[Int(handle.type.rawValue)].free(handle.slot)
+    }
+
+    func removeAll() {
+        tables = [TypeTable](repeating: TypeTable(), count: MapSceneStore.typeCount)
+        children.removeAll()
+        handles.removeAll()
+        dirtyHandles.removeAll()
+    }
+
+    // MARK: Lookup
+
+    func handle(for object: NMAMapObject) -> MapSceneHandle? {
+        return handles[ObjectIdentifier(object)]
+    }
+
+    func object(for handle: MapSceneHandle) -> NMAMapObject? {
+        return tables[Int(handle.type.rawValue)].objects[handle.slot]
+    }
+
+    func parent(of handle: MapSceneHandle) -> MapSceneHandle? {
+        let slot = tables[Int(handle.type.rawValue)].parents[handle.slot]
+        return slot >= 0 ? MapSceneHandle(type: .container, slot: Int(slot)) : nil
+    }
+
+    func children(of container: MapSceneHandle) -> [MapSceneHandle] {
+        precondition(container.type == .container, "MapSceneStore: not a container")
+        return children[container.slot]
+    }
+
+    /// Calls `body` for every live object of `type`, in slot order.
+    func forEach(_ type: NMAMapObjectType, _ body: (MapSceneHandle, NMAMapObject) -> Void) {
+        let table = tables[Int(type.rawValue)]
+        for slot in 0..<table.objects.count {
+            if let object = table.objects[slot] {
+                body(MapSceneHandle(type: type, slot: slot), object)
+            }
+        }
+    }
+
+    // MARK: Dirty tracking
+
+    var hasChanges: Bool {
+        return !dirtyHandles.isEmpty
+    }
+
+    func markDirty(_ object: NMAMapObject) {
+        if let handle = handles[ObjectIdentifier(object)] {
+            markDirty(handle)
+        }
+    }
+
+    func markDirty(_ handle: MapSceneHandle) {
+        let type = Int(handle.type.rawValue)
+        guard !tables[type].dirty[handle.slot] else { return }
+        tables[type].dirty[handle.slot] = true
+        dirtyHandles.append(handle)
+    }
+
+    func isDirty(_ handle: MapSceneHandle) -> Bool {
+        return tables[Int(handle.type.rawValue)].dirty[handle.slot]
+    }
+
+    /// Visits each object changed since the last call once and clears its flag.
+    /// Objects removed in between are skipped.
+    func consumeChanges(_ body: (MapSceneHandle, NMAMapObject) -> Void) {
+        let pending = dirtyHandles
+        dirtyHandles.removeAll(keepingCapacity: true)
+        for handle in pending {
+            let type = Int(handle.type.rawValue)
+            guard tables[type].dirty[handle.slot], let object = tables[type].objects[handle.slot] else { continue }
+            tables[type].dirty[handle.slot] = false
+            body(handle, object)
+        }
+    }
+}
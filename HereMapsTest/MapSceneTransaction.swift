@@ -0,0 +1,183 @@
+//
+//  MapSceneTransaction.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+
+/// Groups map object adds, removes, moves and property changes into one update.
+///
+/// Between `begin()` and `commit()` nothing touches the map view; changes are coalesced per
+/// object (the last move wins, an add followed by a remove cancels out). `commit()` then
+/// turns rendering off, sets all properties, issues one `remove(objects:)` and one
+/// `add(objects:)`, updates the attached indexes once per touched object and turns
+/// rendering back on, so the whole diff costs one redraw.
+///
+///     transaction.begin()
+///     for (marker, position) in updates {
+///         transaction.move(marker, to: position)
+///     }
+///     transaction.commit()
+final class MapSceneTransaction {
+
+    fileprivate enum Membership {
+        case unchanged, added, removed
+        /// Added and removed again: never reaches the map, its changes are dropped.
+        case cancelled
+    }
+
+    fileprivate struct Pending {
+        let object: NMAMapObject
+        var membership: Membership
+        var coordinates: NMAGeoCoordinates?
+        var changes: [(NMAMapObject) -> Void]
+    }
+
+    let mapView: NMAMapView
+    /// Kept in sync on commit, if set.
+    var hitTestIndex: MapHitTestIndex?
+    /// Root objects are registered and changed objects marked dirty on commit, if set.
+    var sceneStore: MapSceneStore?
+
+    fileprivate var pending: [ObjectIdentifier: Int] = [:]
+    fileprivate var queue: [Pending] = []
+    fileprivate(set) var isOpen = false
+
+    init(mapView: NMAMapView) {
+        self.mapView = mapView
+    }
+
+    // MARK: Recording
+
+    func begin() {
+        precondition(!isOpen, "MapSceneTransaction: transaction already open")
+        isOpen = true
+    }
+
+    func add(_ object: NMAMapObject) {
+        record(object) { entry in
+            entry.membership = entry.membership == .removed ? .unchanged : .added
+        }
+    }
+
+    func remove(_ object: NMAMapObject) {
+        record(object) { entry in
+            switch entry.membership {
+            case .added, .cancelled:
+                entry.membership = .cancelled
+            case .unchanged, .removed:
+                entry.membership = .removed
+            }
+        }
+    }
+
+    func move(_ marker: NMAMapMarker, to coordinates: NMAGeoCoordinates) {
+        record(marker) { $0.coordinates = coordinates }
+    }
+
+    func move(_ circle: NMAMapCircle, to coordinates: NMAGeoCoordinates) {
+        record(circle) { $0.coordinates = coordinates }
+    }
+
+    /// Records a property change; changes to one object run in the order recorded.
+    func update<T: NMAMapObject>(_ object: T, _ change: @escaping (T) -> Void) {
+        record(object) { entry in
+            entry.changes.append { change($0 as! T) }
+        }
+    }
+
+    fileprivate func record(_ object: NMAMapObject, _ edit: (inout Pending) -> Void) {
+        precondition(isOpen, "MapSceneTransaction: begin() was not called")
+        let key = ObjectIdentifier(object)
+        if let index = pending[key] {
+            edit(&queue[index])
+        } else {
+            var entry = Pending(object: object, membership: .unchanged, coordinates: nil, changes: [])
+            edit(&entry)
+            pending[key] = queue.count
+            queue.append(entry)
+        }
+    }
+
+    // MARK: Applying
+
+    /// Discards everything recorded since `begin()`.
+    func cancel() {
+        pending.removeAll(keepingCapacity: true)
+        queue.removeAll(keepingCapacity: true)
+        isOpen = false
+    }
+
+    func commit() {
+        precondition(isOpen, "MapSceneTransaction: begin() was not called")
+        let entries = queue.filter { $0.membership != .cancelled }
+        cancel()
+        guard !entries.isEmpty else { return }
+
+        let renderAllowed = mapView.renderAllowed
+        mapView.renderAllowed = false
+        defer { mapView.renderAllowed = renderAllowed }
+
+        var added = [NMAMapObject]()
+        var removed = [NMAMapObject]()
+        var changed = [NMAMapObject]()
+        for entry in entries {
+            switch entry.membership {
+            case .removed:
+                removed.append(entry.object)
+                continue
+            case .added:
+                added.append(entry.object)
+            case .cancelled:
+                continue
+            case .unchanged:
+                if entry.coordinates != nil || !entry.changes.isEmpty {
+                    changed.append(entry.object)
+                }
+            }
+            if let coordinates = entry.coordinates {
+                if let marker = entry.object as? NMAMapMarker {
+                    marker.coordinates = coordinates
+                } else if let circle = entry.object as? NMAMapCircle {
+                    circle.center = coordinates
+                }
+            }
+            for change in entry.changes {
+                change(entry.object)
+            }
+        }
+
+        if !removed.isEmpty {
+            mapView.remove(objects: removed)
+        }
+        if !added.isEmpty {
+            mapView.add(objects: added)
+        }
+
+        if let index = hitTestIndex {
+            removed.forEach { index.remove($0) }
+            changed.forEach { index.update($0) }
+            added.forEach { index.add($0) }
+        }
+        if let store = sceneStore {
+            removed.forEach { store.remove($0) }
+            changed.forEach { store.markDirty($0) }
+            added.filter { store.handle(for: $0) == nil }.forEach { store.add($0) }
+        }
+    }
+}
+
+extension NMAMapView {
+
+    /// Runs `updates` inside a transaction and commits it.
+    func performBatchUpdates(hitTestIndex: MapHitTestIndex? = nil, _ updates: (MapSceneTransaction) -> Void) {
+        let transaction = MapSceneTransaction(mapView: self)
+        transaction.hitTestIndex = hitTestIndex
+        transaction.begin()
+        updates(transaction)
+        transaction.commit()
+    }
+}
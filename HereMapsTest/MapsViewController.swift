@@ -22,7 +22,8 @@ class MapsViewController: UIViewController {
     
     var locationManager = CLLocationManager()
     let defaultMapZoom : Float = 14
-    var mapCircle = NMAMapCircle()
+    var mapCircle: NMAMapCircle?
+    let markerImage = UIImage(named: "Marker-48.png")!
     override func viewDidLoad() {
         super.viewDidLoad()
         
@@ -50,7 +51,7 @@ extension MapsViewController: MenuViewControllerDelegate {
             
             let coordinates = NMAGeoCoordinates(latitude: item.coordinates.latitude, longitude: item.coordinates.longitude)
             mapView.set(geoCenter: coordinates, animation: .linear)
-            let marker = NMAMapMarker(geoCoordinates: coordinates, image: UIImage(named: "Marker-48.png"))!
+            let marker = NMAMapMarker(geoCoordinates: coordinates, image: IconAtlas.shared.icon(for: markerImage))!
             marker.title = item.title
             mapView.add(marker)
         } else {
@@ -66,9 +67,14 @@ extension MapsViewController: CLLocationManagerDelegate {
         let coordinates = NMAGeoCoordinates(latitude: (location?.coordinate.latitude)!, longitude: (location?.coordinate.longitude)!)
         
         mapView.set(geoCenter: coordinates, animation: .linear)
-        mapView.remove(mapCircle)
-        mapCircle = NMAMapCircle(coordinates: coordinates, radius: 50)
-        mapView.add(mapCircle)
+        // Move the existing circle rather than replacing it, so it isn't tessellated again.
+        if let circle = mapCircle {
+            circle.center = coordinates
+        } else {
+            let circle = NMAMapCircle(coordinates: coordinates, radius: 50)
+            mapView.add(circle)
+            mapCircle = circle
+        }
         
         //Finally stop updating location otherwise it will come again and again in this delegate
         self.locationManager.stopUpdatingLocation()
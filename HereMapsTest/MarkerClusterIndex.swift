@@ -0,0 +1,356 @@
+//
+//  MarkerClusterIndex.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+
+/// One cluster of the index at a given zoom.
+struct MarkerCluster {
+    /// Integer zoom the cluster was built for.
+    let zoom: Int
+    /// Cell of the cluster (`GeoCellId` over the Web Mercator grid, see `MarkerClusterIndex`).
+    let cell: GeoCellId
+    let count: Int
+    /// Mean position of the clustered markers.
+    let coordinates: NMAGeoCoordinates
+}
+
+/// What to draw for one cell of the viewport: a single marker or a cluster of several.
+enum MarkerClusterItem {
+    case marker(NMAMapMarker)
+    case cluster(MarkerCluster)
+}
+
+/// Zoom-aware marker clustering, for marker sets too large for `NMAMapView.add(objects:)`.
+///
+/// Markers are snapped to a quadtree over normalized Web Mercator: zoom `z` clusters by
+/// cells of `2^(z + 2)` per axis, i.e. about 64 x 64 pt with 256 pt tiles. The cells are
+/// `GeoCellId`s (Morton order with a level sentinel), so every zoom nests in the next and a
+/// cluster's children are its four child cells. Each zoom keeps a table of non-empty cells
+/// with count, position sums and the XOR of member ids (which is the remaining member when
+/// the count is one), so:
+/// * a viewport query looks up only the cells on screen, independent of the marker count;
+/// * insert and remove update one cell per zoom;
+/// * bulk loading sorts the leaf cells once and fills the zoom tables in parallel.
+///
+/// Unlike supercluster's greedy merging, cluster borders are fixed grid lines, which is
+/// what makes updates incremental.
+final class MarkerClusterIndex {
+
+    fileprivate struct Cell {
+        var count: Int32 = 0
+        var memberXor: Int32 = 0
+        var sumX: Double = 0
+        var sumY: Double = 0
+    }
+
+    let minZoom: Int
+    let maxZoom: Int
+    /// Cells per axis at zoom 0 is `1 << levelOffset`.
+    fileprivate let levelOffset = 2
+
+    fileprivate var slots: [NMAMapMarker?] = []
+    fileprivate var xs: [Double] = []
+    fileprivate var ys: [Double] = []
+    fileprivate var leafCells: [UInt64] = []
+    fileprivate var freeIds: [Int] = []
+    fileprivate var ids: [ObjectIdentifier: Int] = [:]
+    /// Non-empty cells per zoom, `levels[z - minZoom]`.
+    fileprivate var levels: [[UInt64: Cell]]
+    /// Members of each leaf cell, for zooms past `maxZoom`.
+    fileprivate var leaves: [UInt64: [Int32]] = [:]
+
+    init(minZoom: Int = 0, maxZoom: Int = 20) {
+        precondition(minZoom >= 0 && minZoom <= maxZoom && maxZoom + 2 < GeoCellId.maxLevel, "MarkerClusterIndex: invalid zoom range")
+        self.minZoom = minZoom
+        self.maxZoom = maxZoom
+        levels = [[UInt64: Cell]](repeating: [:], count: maxZoom - minZoom + 1)
+    }
+
+    /// Builds the index for `markers` in one pass.
+    convenience init(markers: [NMAMapMarker], minZoom: Int = 0, maxZoom: Int = 20) {
+        self.init(minZoom: minZoom, maxZoom: maxZoom)
+        load(markers)
+    }
+
+    var count: Int {
+        return ids.count
+    }
+
+    fileprivate var leafLevel: Int {
+        return maxZoom + levelOffset
+    }
+
+    fileprivate func leafCell(x: Double, y: Double) -> UInt64 {
+        let size = Double(1 << leafLevel)
+        let i = UInt64(min(max(x * size, 0), size - 1))
+        let j = UInt64(min(max(y * size, 0), size - 1))
+        return GeoCellId(i: i, j: j, level: leafLevel).rawValue
+    }
+
+    /// Mercator y clamped to the map's latitude range, so markers at the poles stay finite
+    /// and don't turn cluster sums into NaN.
+    fileprivate static func mercatorY(latitude: Double) -> Double {
+        let limit = MercatorProjection.maxLatitude
+        return MercatorProjection.mercatorY(latitude: min(max(latitude, -limit), limit))
+    }
+
+    // MARK: Loading
+
+    fileprivate func load(_ newMarkers: [NMAMapMarker]) {
+        precondition(ids.isEmpty, "MarkerClusterIndex: bulk load into a non-empty index")
+        precondition(newMarkers.count < Int(Int32.max), "MarkerClusterIndex: too many markers")
+        let count = newMarkers.count
+        slots = newMarkers.map { Optional($0) }
+        xs = [Double](repeating: 0, count: count)
+        ys = [Double](repeating: 0, count: count)
+        leafCells = [UInt64](repeating: 0, count: count)
+        for (id, marker) in newMarkers.enumerated() {
+            precondition(ids[ObjectIdentifier(marker)] == nil, "MarkerClusterIndex: marker added twice")
+            ids[ObjectIdentifier(marker)] = id
+            xs[id] = MercatorProjection.mercatorX(longitude: marker.coordinates.longitude)
+            ys[id] = MarkerClusterIndex.mercatorY(latitude: marker.coordinates.latitude)
+            leafCells[id] = leafCell(x: xs[id], y: ys[id])
+        }
+
+        // Sorted by leaf cell, every coarser cell is a contiguous run.
+        let cells = leafCells, x = xs, y = ys
+        let order = (0..<count).sorted { cells[$0] < cells[$1] }
+        let firstLevel = minZoom + levelOffset
+        let levelCount = levels.count
+        var built = [[UInt64: Cell]](repeating: [:], count: levelCount)
+        built.withUnsafeMutableBufferPointer { tables in
+            let tables = tables.baseAddress!
+            DispatchQueue.concurrentPerform(iterations: levelCount) { index in
+                let level = firstLevel + index
+                var table = [UInt64: Cell]()
+                var start = 0
+                while start < count {
+                    let key = GeoCellId(rawValue: cells[order[start]]).parent(level: level).rawValue
+                    var cell = Cell()
+                    var end = start
+                    while end < count && GeoCellId(rawValue: cells[order[end]]).parent(level: level).rawValue == key {
+                        let id = order[end]
+                        cell.count += 1
+                        cell.memberXor ^= Int32(id)
+                        cell.sumX += x[id]
+                        cell.sumY += y[id]
+                        end += 1
+                    }
+                    table[key] = cell
+                    start = end
+                }
+                tables[index] = table
+            }
+        }
+        levels = built
+        for id in order {
+            var members = leaves[cells[id]] ?? []
+            members.append(Int32(id))
+            leaves[cells[id]] = members
+        }
+    }
+
+    // MARK: Incremental updates
+
+    /// Adds `marker` at its current coordinates.
+    func insert(_ marker: NMAMapMarker) {
+        precondition(ids[ObjectIdentifier(marker)] == nil, "MarkerClusterIndex: marker added twice")
+        let x = MercatorProjection.mercatorX(longitude: marker.coordinates.longitude)
+        let y = MarkerClusterIndex.mercatorY(latitude: marker.coordinates.latitude)
+        let leaf = leafCell(x: x, y: y)
+        let id: Int
+        if let free = freeIds.popLast() {
+            id = free
+            slots[id] = marker
+            xs[id] = x
+            ys[id] = y
+            leafCells[id] = leaf
+        } else {
+            id = slots.count
+            slots.append(marker)
+            xs.append(x)
+            ys.append(y)
+            leafCells.append(leaf)
+        }
+        ids[ObjectIdentifier(marker)] = id
+        update(id: id, sign: 1)
+        var members = leaves[leaf] ?? []
+        members.append(Int32(id))
+        leaves[leaf] = members
+    }
+
+    func remove(_ marker: NMAMapMarker) {
+        guard let id = ids.removeValue(forKey: ObjectIdentifier(marker)) else { return }
+        update(id: id, sign: -1)
+        let leaf = leafCells[id]
+        if var members = leaves[leaf], let position = members.index(of: Int32(id)) {
+            members.remove(at: position)
+            leaves[leaf] = members.isEmpty ? nil : members
+        }
+        slots[id] = nil
+        freeIds.append(id)
+    }
+
+    /// Re-buckets `marker` after its coordinates changed.
+    func move(_ marker: NMAMapMarker) {
+        remove(marker)
+        insert(marker)
+    }
+
+    fileprivate func update(id: Int, sign: Int32) {
+        let leaf = GeoCellId(rawValue: leafCells[id])
+        let x = xs[id] * Double(sign), y = ys[id] * Double(sign)
+        for index in 0..<levels.count {
+            let key = leaf.parent(level: minZoom + index + levelOffset).rawValue
+            var cell = levels[index][key] ?? Cell()
+            cell.count += sign
+            cell.memberXor ^= Int32(id)
+            cell.sumX += x
+            cell.sumY += y
+            levels[index][key] = cell.count > 0 ? cell : nil
+        }
+    }
+
+    // MARK: Queries
+
+    /// Clusters and single markers inside `box` at the map's `zoomLevel`, e.g.
+    /// `items(in: GeoBox(mapView.boundingBox), zoomLevel: mapView.zoomLevel)`.
+    func items(in box: GeoBox, zoomLevel: Float) -> [MarkerClusterItem] {
+        let zoom = Int(zoomLevel.rounded(.down))
+        if zoom > maxZoom {
+            return markers(in: box).map { .marker($0) }
+        }
+        let z = max(zoom, minZoom)
+        let level = z + levelOffset
+        let table = levels[z - minZoom]
+        var result = [MarkerClusterItem]()
+        forEachCell(in: box, level: level, table: table) { key, cell in
+            if cell.count == 1, let marker = slots[Int(cell.memberXor)] {
+                result.append(.marker(marker))
+            } else {
+                result.append(.cluster(cluster(key: key, cell: cell, zoom: z)))
+            }
+        }
+        return result
+    }
+
+    /// Individual markers inside `box`, ignoring clustering.
+    func markers(in box: GeoBox) -> [NMAMapMarker] {
+        var result = [NMAMapMarker]()
+        // The finest zoom's cells are the leaf cells.
+        let table = levels[levels.count - 1]
+        forEachCell(in: box, level: leafLevel, table: table) { key, _ in
+            appendLeaves(of: GeoCellId(rawValue: key), to: &result, inside: box)
+        }
+        return result
+    }
+
+    /// Zoom at which `cluster` first splits into more than one item (tap-to-expand target).
+    func expansionZoom(of cluster: MarkerCluster) -> Int {
+        var cell = cluster.cell
+        var zoom = cluster.zoom
+        while zoom < maxZoom {
+            let next = children(of: cell, zoom: zoom + 1)
+            if next.count > 1 {
+                return zoom + 1
+            }
+            guard let only = next.first else { break }
+            cell = only
+            zoom += 1
+        }
+        return maxZoom + 1
+    }
+
+    /// Items one zoom below `cluster`.
+    func children(of cluster: MarkerCluster) -> [MarkerClusterItem] {
+        let zoom = cluster.zoom + 1
+        guard zoom <= maxZoom else { return leaves(of: cluster).map { .marker($0) } }
+        let table = levels[zoom - minZoom]
+        return children(of: cluster.cell, zoom: zoom).flatMap { key -> MarkerClusterItem? in
+            guard let cell = table[key.rawValue] else { return nil }
+            if cell.count == 1, let marker = slots[Int(cell.memberXor)] {
+                return .marker(marker)
+            }
+            return .cluster(self.cluster(key: key.rawValue, cell: cell, zoom: zoom))
+        }
+    }
+
+    /// All markers in `cluster`.
+    func leaves(of cluster: MarkerCluster) -> [NMAMapMarker] {
+        var result = [NMAMapMarker]()
+        appendLeaves(of: cluster.cell, to: &result, inside: nil)
+        return result
+    }
+
+    // MARK: Helpers
+
+    fileprivate func cluster(key: UInt64, cell: Cell, zoom: Int) -> MarkerCluster {
+        let n = Double(cell.count)
+        let coordinates = NMAGeoCoordinates(latitude: MercatorProjection.latitude(mercatorY: cell.sumY / n),
+                                            longitude: MercatorProjection.longitude(mercatorX: cell.sumX / n))
+        return MarkerCluster(zoom: zoom, cell: GeoCellId(rawValue: key), count: Int(cell.count), coordinates: coordinates)
+    }
+
+    fileprivate func children(of cell: GeoCellId, zoom: Int) -> [GeoCellId] {
+        let table = levels[zoom - minZoom]
+        return cell.children.filter { table[$0.rawValue] != nil }
+    }
+
+    fileprivate func appendLeaves(of cell: GeoCellId, to result: inout [NMAMapMarker], inside box: GeoBox?) {
+        if cell.level == leafLevel {
+            for id in leaves[cell.rawValue] ?? [] {
+                guard let marker = slots[Int(id)] else { continue }
+                if let box = box, !box.contains(latitude: marker.coordinates.latitude, longitude: marker.coordinates.longitude) {
+                    continue
+                }
+                result.append(marker)
+            }
+            return
+        }
+        let table = levels[cell.level - levelOffset - minZoom]
+        guard table[cell.rawValue] != nil else { return }
+        for child in cell.children {
+            appendLeaves(of: child, to: &result, inside: box)
+        }
+    }
+
+    /// Visits the non-empty cells of `table` (cells at `level`) that overlap `box`.
+    fileprivate func forEachCell(in box: GeoBox, level: Int, table: [UInt64: Cell], _ body: (UInt64, Cell) -> Void) {
+        let size = 1 << level
+        let scale = Double(size)
+        let grid = { (value: Double) -> Int in Int(min(max(value * scale, 0), scale - 1)) }
+        let top = grid(MercatorProjection.mercatorY(latitude: box.north))
+        let bottom = grid(MercatorProjection.mercatorY(latitude: box.south))
+        let west = grid(MercatorProjection.mercatorX(longitude: box.west))
+        var columns = min(max(Int(ceil(box.longitudeSpan / 360 * scale)) + 1, 1), size)
+        if box.longitudeSpan >= 360 {
+            columns = size
+        }
+
+        // Box much larger than the populated area: walking the table is cheaper than the grid.
+        if columns * (bottom - top + 1) > table.count {
+            for (key, cell) in table {
+                let (i, j) = GeoCellId(rawValue: key).position
+                let column = (Int(i) - west + size) % size
+                if Int(j) >= top && Int(j) <= bottom && column < columns {
+                    body(key, cell)
+                }
+            }
+            return
+        }
+        for j in top...bottom {
+            for column in 0..<columns {
+                let i = (west + column) % size
+                let key = GeoCellId(i: UInt64(i), j: UInt64(j), level: level).rawValue
+                if let cell = table[key] {
+                    body(key, cell)
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,268 @@
+//
+//  MercatorProjection.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import UIKit
+import Accelerate
+
+/// Snapshot of an `NMAMapView` camera for batch screen projection.
+///
+/// `NMAMapView` exposes no tilt, so screen space is an affine image of Web Mercator.
+/// The snapshot samples three screen corners through the view's own
+/// `geoCoordinates(from:)` / `point(from:)` pair and solves that affine map, so batch
+/// results follow the per-point methods. Take a new snapshot whenever the map moves.
+struct MercatorProjection {
+
+    // screen = [a b; c d] * mercator + [tx; ty]
+    fileprivate let a, b, c, d, tx, ty: Double
+    // mercator = inverse * (screen - [tx; ty])
+    fileprivate let ia, ib, ic, id: Double
+    /// Mercator x of the view center; points are wrapped to the copy of the world nearest to it.
+    fileprivate let centerX: Double
+
+    init?(mapView: NMAMapView) {
+        let bounds = mapView.bounds
+        guard bounds.width > 0, bounds.height > 0 else { return nil }
+        let corners = [CGPoint(x: bounds.minX, y: bounds.minY),
+                       CGPoint(x: bounds.maxX, y: bounds.minY),
+                       CGPoint(x: bounds.minX, y: bounds.maxY)]
+        var mercator = [(x: Double, y: Double)]()
+        var screen = [CGPoint]()
+        let centerX = MercatorProjection.mercatorX(longitude: mapView.geoCenter.longitude)
+        for corner in corners {
+            guard let coordinates = mapView.geoCoordinates(from: corner) else { return nil }
+            var x = MercatorProjection.mercatorX(longitude: coordinates.longitude)
+            x -= (x - centerX).rounded()
+            mercator.append((x: x, y: MercatorProjection.mercatorY(latitude: coordinates.latitude)))
+            screen.append(mapView.point(from: coordinates))
+        }
+
+        // Solve A from the two corner differences, then the translation.
+        let m1x = mercator[1].x - mercator[0].x, m1y = mercator[1].y - mercator[0].y
+        let m2x = mercator[2].x - mercator[0].x, m2y = mercator[2].y - mercator[0].y
+        let s1x = Double(screen[1].x - screen[0].x), s1y = Double(screen[1].y - screen[0].y)
+        let s2x = Double(screen[2].x - screen[0].x), s2y = Double(screen[2].y - screen[0].y)
+        let determinant = m1x * m2y - m2x * m1y
+        guard determinant != 0 else { return nil }
+        let a = (s1x * m2y - s2x * m1y) / determinant
+        let b = (s2x * m1x - s1x * m2x) / determinant
+        let c = (s1y * m2y - s2y * m1y) / determinant
+        let d = (s2y * m1x - s1y * m2x) / determinant
+        self.init(a: a, b: b, c: c, d: d,
+                  tx: Double(screen[0].x) - a * mercator[0].x - b * mercator[0].y,
+                  ty: Double(screen[0].y) - c * mercator[0].x - d * mercator[0].y,
+                  centerX: centerX)
+    }
+
+    init?(a: Double, b: Double, c: Double, d: Double, tx: Double, ty: Double, centerX: Double) {
+        let determinant = a * d - b * c
+        guard determinant != 0 else { return nil }
+        self.a = a
+        self.b = b
+        self.c = c
+        self.d = d
+        self.tx = tx
+        self.ty = ty
+        self.ia = d / determinant
+        self.ib = -b / determinant
+        self.ic = -c / determinant
+        self.id = a / determinant
+        self.centerX = centerX
+    }
+
+    /// Screen points per unit of normalized Mercator (the world is 1 x 1).
+    var scale: Double {
+        return sqrt(abs(a * d - b * c))
+    }
+
+    // MARK: Web Mercator
+
+    /// Latitude where Web Mercator y reaches 0 and 1; the poles themselves map to infinity.
+    static let maxLatitude = 85.05112877980659
+
+    /// Normalized Web Mercator x in [0, 1).
+    static func mercatorX(longitude: Double) -> Double {
+        return longitude / 360 + 0.5
+    }
+
+    /// Normalized Web Mercator y in [0, 1], growing southwards like screen y.
+    static func mercatorY(latitude: Double) -> Double {
+        let s = sin(latitude * GeoBatch.degreesToRadians)
+        return 0.5 - log((1 + s) / (1 - s)) / (4 * Double.pi)
+    }
+
+    static func latitude(mercatorY y: Double) -> Double {
+        return atan(sinh(Double.pi * (1 - 2 * y))) * GeoBatch.radiansToDegrees
+    }
+
+    static func longitude(mercatorX x: Double) -> Double {
+        let longitude = (x - 0.5) * 360
+        return longitude - 360 * ((longitude + 180) / 360).rounded(.down)
+    }
+
+    // MARK: Single point
+
+    func point(latitude: Double, longitude: Double) -> CGPoint {
+        var x = MercatorProjection.mercatorX(longitude: longitude)
+        x -= (x - centerX).rounded()
+        let y = MercatorProjection.mercatorY(latitude: latitude)
+        return CGPoint(x: a * x + b * y + tx, y: c * x + d * y + ty)
+    }
+
+    func geoCoordinates(at point: CGPoint) -> (latitude: Double, longitude: Double) {
+        let sx = Double(point.x) - tx
+        let sy = Double(point.y) - ty
+        return (latitude: MercatorProjection.latitude(mercatorY: ic * sx + id * sy),
+                longitude: MercatorProjection.longitude(mercatorX: ia * sx + ib * sy))
+    }
+
+    // MARK: Batch
+
+    /// Projects coordinates to screen space, writing x and y into separate buffers.
+    func project(latitudes: UnsafeBufferPointer<Double>, longitudes: UnsafeBufferPointer<Double>,
+                 x xs: UnsafeMutableBufferPointer<Double>, y ys: UnsafeMutableBufferPointer<Double>) {
+        let count = latitudes.count
+        precondition(longitudes.count == count && xs.count >= count && ys.count >= count, "MercatorProjection: buffer size mismatch")
+        guard count > 0, let lats = latitudes.baseAddress, let lons = longitudes.baseAddress,
+            let outX = xs.baseAddress, let outY = ys.baseAddress else { return }
+
+        let chunkSize = 1024
+        var scratch = [Double](repeating: 0, count: 3 * chunkSize)
+        scratch.withUnsafeMutableBufferPointer { buffer in
+            let mx = buffer.baseAddress!
+            let my = mx + chunkSize
+            let t = my + chunkSize
+            var inverse360 = 1.0 / 360, half = 0.5, minusCenter = -centerX, one = 1.0, minusOne = -1.0
+            var toRadians = GeoBatch.degreesToRadians, yScale = -1 / (4 * Double.pi)
+            var a = self.a, b = self.b, c = self.c, d = self.d, tx = self.tx, ty = self.ty
+
+            var offset = 0
+            while offset < count {
+                let n = min(chunkSize, count - offset)
+                var n32 = Int32(n)
+                let length = vDSP_Length(n)
+
+                // x = lon / 360 + 0.5, wrapped to the world copy nearest the center
+                vDSP_vsmsaD(lons + offset, 1, &inverse360, &half, mx, 1, length)
+                vDSP_vsaddD(mx, 1, &minusCenter, t, 1, length)
+                vvnint(t, t, &n32)
+                vDSP_vsubD(t, 1, mx, 1, mx, 1, length)
+                // y = 0.5 - log((1 + s) / (1 - s)) / 4pi, s = sin(lat)
+                vDSP_vsmulD(lats + offset, 1, &toRadians, t, 1, length)
+                vvsin(t, t, &n32)
+                vDSP_vsmsaD(t, 1, &minusOne, &one, my, 1, length)
+                vDSP_vsaddD(t, 1, &one, t, 1, length)
+                vDSP_vdivD(my, 1, t, 1, my, 1, length)
+                vvlog(my, my, &n32)
+                vDSP_vsmsaD(my, 1, &yScale, &half, my, 1, length)
+                // screen = A * mercator + t
+                vDSP_vsmsaD(mx, 1, &a, &tx, outX + offset, 1, length)
+                vDSP_vsmaD(my, 1, &b, outX + offset, 1, outX + offset, 1, length)
+                vDSP_vsmsaD(mx, 1, &c, &ty, outY + offset, 1, length)
+                vDSP_vsmaD(my, 1, &d, outY + offset, 1, outY + offset, 1, length)
+
+                offset += n
+            }
+        }
+    }
+
+    /// Converts screen points back to coordinates; longitudes are normalized to [-180, 180).
+    func unproject(x xs: UnsafeBufferPointer<Double>, y ys: UnsafeBufferPointer<Double>,
+                   latitudes: UnsafeMutableBufferPointer<Double>, longitudes: UnsafeMutableBufferPointer<Double>) {
+        let count = xs.count
+        precondition(ys.count == count && latitudes.count >= count && longitudes.count >= count, "MercatorProjection: buffer size mismatch")
+        guard count > 0, let inX = xs.baseAddress, let inY = ys.baseAddress,
+            let lats = latitudes.baseAddress, let lons = longitudes.baseAddress else { return }
+
+        let chunkSize = 1024
+        var scratch = [Double](repeating: 0, count: 2 * chunkSize)
+        scratch.withUnsafeMutableBufferPointer { buffer in
+            let sx = buffer.baseAddress!
+            let sy = sx + chunkSize
+            var minusTx = -tx, minusTy = -ty
+            var ia = self.ia, ib = self.ib, ic = self.ic, id = self.id
+            var minusHalf = -0.5, full = 360.0, yScale = -2 * Double.pi, yOffset = Double.pi
+            var toDegrees = GeoBatch.radiansToDegrees
+
+            var offset = 0
+            while offset < count {
+                let n = min(chunkSize, count - offset)
+                var n32 = Int32(n)
+                let length = vDSP_Length(n)
+                let lat = lats + offset
+                let lon = lons + offset
+
+                vDSP_vsaddD(inX + offset, 1, &minusTx, sx, 1, length)
+                vDSP_vsaddD(inY + offset, 1, &minusTy, sy, 1, length)
+                // mercator x -> longitude
+                vDSP_vsmulD(sx, 1, &ia, lon, 1, length)
+                vDSP_vsmaD(sy, 1, &ib, lon, 1, lon, 1, length)
+                vDSP_vsaddD(lon, 1, &minusHalf, lon, 1, length)
+                vDSP_vsmulD(lon, 1, &full, lon, 1, length)
+                // mercator y -> latitude = atan(sinh(pi - 2pi * y))
+                vDSP_vsmulD(sx, 1, &ic, lat, 1, length)
+                vDSP_vsmaD(sy, 1, &id, lat, 1, lat, 1, length)
+                vDSP_vsmsaD(lat, 1, &yScale, &yOffset, lat, 1, length)
+                vvsinh(lat, lat, &n32)
+                vvatan(lat, lat, &n32)
+                vDSP_vsmulD(lat, 1, &toDegrees, lat, 1, length)
+                for i in 0..<n {
+                    let longitude = lon[i]
+                    lon[i] = longitude - 360 * ((longitude + 180) / 360).rounded(.down)
+                }
+
+                offset += n
+            }
+        }
+    }
+
+    func points(for buffer: GeoCoordinateBuffer) -> [CGPoint] {
+        var xs = [Double](repeating: 0, count: buffer.count)
+        var ys = [Double](repeating: 0, count: buffer.count)
+        buffer.withUnsafeBuffers { lats, lons, _ in
+            xs.withUnsafeMutableBufferPointer { x in
+                ys.withUnsafeMutableBufferPointer { y in
+                    project(latitudes: lats, longitudes: lons, x: x, y: y)
+                }
+            }
+        }
+        var points = [CGPoint]()
+        points.reserveCapacity(buffer.count)
+        for i in 0..<buffer.count {
+            points.append(CGPoint(x: xs[i], y: ys[i]))
+        }
+        return points
+    }
+
+    /// Batch `NMAMapView.pointDistance(from:to:)`: screen distance between pairs of coordinates.
+    func pointDistances(from start: GeoCoordinateBuffer, to end: GeoCoordinateBuffer) -> [Double] {
+        precondition(start.count == end.count, "MercatorProjection: buffer size mismatch")
+        let count = start.count
+        var startX = [Double](repeating: 0, count: count), startY = startX
+        var endX = startX, endY = startX
+        start.withUnsafeBuffers { lats, lons, _ in
+            startX.withUnsafeMutableBufferPointer { x in
+                startY.withUnsafeMutableBufferPointer { y in
+                    project(latitudes: lats, longitudes: lons, x: x, y: y)
+                }
+            }
+        }
+        end.withUnsafeBuffers { lats, lons, _ in
+            endX.withUnsafeMutableBufferPointer { x in
+                endY.withUnsafeMutableBufferPointer { y in
+                    project(latitudes: lats, longitudes: lons, x: x, y: y)
+                }
+            }
+        }
+        var dx = [Double](repeating: 0, count: count), dy = dx
+        var distances = dx
+        vDSP_vsubD(startX, 1, endX, 1, &dx, 1, vDSP_Length(count))
+        vDSP_vsubD(startY, 1, endY, 1, &dy, 1, vDSP_Length(count))
+        vDSP_vdistD(dx, 1, dy, 1, &distances, 1, vDSP_Length(count))
+        return distances
+    }
+}
@@ -0,0 +1,198 @@
+//
+//  PolygonContainmentIndex.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+
+/// Point-in-polygon for large polygons (admin areas), replacing the full ray cast of
+/// `NMAMapPolygon.contains(_:)`.
+///
+/// The polygon's latitude range is cut into horizontal slabs and each slab keeps the edges
+/// crossing it, copied into contiguous arrays. A query ray-casts only the edges of its slab,
+/// so the cost is the local edge count instead of the vertex count, about four edges for an
+/// evenly spread polygon. The slab loop has no branches or overflow checks: the compares
+/// become 0/1 masks that are and-ed and summed with `&+=`.
+///
+/// The slabs are built on the first query after any vertex edit. Longitudes are unwrapped
+/// along the ring, so polygons across the date line work. Even-odd rule, planar in degrees
+/// like the SDK.
+final class PolygonContainmentIndex {
+
+    fileprivate(set) var vertices: GeoCoordinateBuffer
+
+    // Slab index, valid while `isBuilt`.
+    fileprivate var isBuilt = false
+    fileprivate var minX = 0.0, minY = 0.0, maxY = 0.0
+    fileprivate var slabHeight = 1.0
+    /// Edges of slab `s` are `slabStarts[s]..<slabStarts[s + 1]`.
+    fileprivate var slabStarts: [Int32] = []
+    fileprivate var edgeLowY: [Double] = []
+    fileprivate var edgeHighY: [Double] = []
+    fileprivate var edgeX: [Double] = []
+    fileprivate var edgeSlope: [Double] = []
+
+    init(vertices: GeoCoordinateBuffer) {
+        self.vertices = vertices
+    }
+
+    convenience init(polygon: NMAMapPolygon) {
+        self.init(vertices: polygon.vertexBuffer)
+    }
+
+    // MARK: Editing
+
+    /// Drops the slabs after the vertices were edited outside the index.
+    func invalidate() {
+        isBuilt = false
+    }
+
+    func replaceVertices(_ newVertices: GeoCoordinateBuffer) {
+        vertices = newVertices
+        invalidate()
+    }
+
+    func append(latitude: Double, longitude: Double) {
+        vertices.append(latitude: latitude, longitude: longitude)
+        invalidate()
+    }
+
+    func insert(latitude: Double, longitude: Double, at index: Int) {
+        vertices.insert(latitude: latitude, longitude: longitude, at: index)
+        invalidate()
+    }
+
+    func remove(at index: Int) {
+        vertices.remove(at: index)
+        invalidate()
+    }
+
+    // MARK: Queries
+
+    func contains(latitude: Double, longitude: Double) -> Bool {
+        buildIfNeeded()
+        return test(latitude: latitude, longitude: longitude)
+    }
+
+    func contains(_ coordinates: NMAGeoCoordinates) -> Bool {
+        return contains(latitude: coordinates.latitude, longitude: coordinates.longitude)
+    }
+
+    /// Classifies every point on the worker pool.
+    func containment(latitudes: UnsafeBufferPointer<Double>, longitudes: UnsafeBufferPointer<Double>) -> GeoBitmask {
+        precondition(latitudes.count == longitudes.count, "PolygonContainmentIndex: latitude/longitude count mismatch")
+        buildIfNeeded()
+        var mask = GeoBitmask(count: latitudes.count)
+        guard let lats = latitudes.baseAddress, let lons = longitudes.baseAddress else { return mask }
+        mask.fill { i in
+            return test(latitude: lats[i], longitude: lons[i])
+        }
+        return mask
+    }
+
+    func containment(of points: GeoCoordinateBuffer) -> GeoBitmask {
+        return points.withUnsafeBuffers { lats, lons, _ in
+            containment(latitudes: lats, longitudes: lons)
+        }
+    }
+
+    // MARK: Slabs
+
+    fileprivate func test(latitude y: Double, longitude: Double) -> Bool {
+        guard isBuilt, y >= minY, y < maxY else { return false }
+        // Longitude into the polygon's unwrapped range.
+        let x = minX + GeoBox.wrappedOffset((longitude - minX).truncatingRemainder(dividingBy: 360))
+        let slab = min(Int((y - minY) / slabHeight), slabStarts.count - 2)
+        let start = Int(slabStarts[slab]), end = Int(slabStarts[slab + 1])
+        var crossings = 0
+        edgeLowY.withUnsafeBufferPointer { lowY in
+            edgeHighY.withUnsafeBufferPointer { highY in
+                edgeX.withUnsafeBufferPointer { edgeX in
+                    edgeSlope.withUnsafeBufferPointer { slope in
+                        for e in start..<end {
+                            let above = y >= lowY[e] ? 1 : 0
+                            let below = y < highY[e] ? 1 : 0
+                            let left = x < edgeX[e] + (y - lowY[e]) * slope[e] ? 1 : 0
+                            crossings &+= above & below & left
+                        }
+                    }
+                }
+            }
+        }
+        return crossings & 1 == 1
+    }
+
+    fileprivate func buildIfNeeded() {
+        guard !isBuilt else { return }
+        let count = vertices.count
+        slabStarts = []
+        edgeLowY = []
+        edgeHighY = []
+        edgeX = []
+        edgeSlope = []
+        guard count >= 3 else {
+            minY = 0
+            maxY = 0
+            isBuilt = true
+            return
+        }
+
+        var xs = [Double](repeating: 0, count: count)
+        let ys = vertices.latitudes
+        xs[0] = vertices.longitudes[0]
+        for i in 1..<count {
+            let x = vertices.longitudes[i]
+            xs[i] = x - ((x - xs[i - 1]) / 360).rounded() * 360
+        }
+        minX = xs.min()!
+        minY = ys.min()!
+        maxY = ys.max()!
+
+        // About four edges per slab for an evenly spread polygon.
+        let slabCount = min(max(count / 4, 1), 65_536)
+        slabHeight = max((maxY - minY) / Double(slabCount), Double.leastNormalMagnitude)
+
+        // Count, then fill (CSR layout).
+        var counts = [Int32](repeating: 0, count: slabCount + 1)
+        func slabRange(_ low: Double, _ high: Double) -> CountableRange<Int> {
+            let first = min(Int((low - minY) / slabHeight), slabCount - 1)
+            let last = min(Int((high - minY) / slabHeight), slabCount - 1)
+            return first..<(last + 1)
+        }
+        for i in 0..<count {
+            let j = (i + 1) % count
+            guard ys[i] != ys[j] else { continue }
+            for s in slabRange(min(ys[i], ys[j]), max(ys[i], ys[j])) {
+                counts[s + 1] += 1
+            }
+        }
+        for s in 0..<slabCount {
+            counts[s + 1] += counts[s]
+        }
+        slabStarts = counts
+        let total = Int(counts[slabCount])
+        edgeLowY = [Double](repeating: 0, count: total)
+        edgeHighY = [Double](repeating: 0, count: total)
+        edgeX = [Double](repeating: 0, count: total)
+        edgeSlope = [Double](repeating: 0, count: total)
+        var cursor = counts
+        for i in 0..<count {
+            let j = (i + 1) % count
+            guard ys[i] != ys[j] else { continue }
+            let (low, high) = ys[i] < ys[j] ? (i, j) : (j, i)
+            let slope = (xs[high] - xs[low]) / (ys[high] - ys[low])
+            for s in slabRange(ys[low], ys[high]) {
+                let e = Int(cursor[s])
+                cursor[s] += 1
+                edgeLowY[e] = ys[low]
+                edgeHighY[e] = ys[high]
+                edgeX[e] = xs[low]
+                edgeSlope[e] = slope
+            }
+        }
+        isBuilt = true
+    }
+}
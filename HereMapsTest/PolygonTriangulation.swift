@@ -0,0 +1,374 @@
+//
+//  PolygonTriangulation.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+
+/// Cached ear-clipping triangulation of a polygon that is being edited vertex by vertex
+/// (interactive drawing).
+///
+/// The triangles are kept between edits. An append, insert or remove only re-triangulates
+/// the cavity formed by the triangles around the edited edge: the cavity outline is ear
+/// clipped with the vertex added or dropped, and the result is accepted when it covers the
+/// outline's area exactly and the new edges cross no triangle outside the cavity. Otherwise
+/// (self-intersection, a thin spike across other triangles) the whole polygon is
+/// triangulated again, so the result is always a valid triangulation of the current ring.
+///
+/// Triangles refer to stable vertex ids internally; `indices()` maps them to ring positions
+/// for drawing. Planar in degrees, longitudes unwrapped along the ring.
+final class PolygonTriangulation {
+
+    /// The ring, in order.
+    fileprivate(set) var vertices = GeoCoordinateBuffer()
+    /// Whether the last edit was handled locally (for diagnostics and benchmarks).
+    fileprivate(set) var lastEditWasLocal = false
+
+    // Vertex storage by stable id.
+    fileprivate var xs: [Double] = []
+    fileprivate var ys: [Double] = []
+    fileprivate var freeIds: [Int32] = []
+    /// Ids in ring order.
+    fileprivate var order: [Int32] = []
+    fileprivate var triangles: [Int32] = []
+    /// Triangles touching each vertex id.
+    fileprivate var star: [[Int32]] = []
+
+    init(vertices: GeoCoordinateBuffer = GeoCoordinateBuffer()) {
+        for i in 0..<vertices.count {
+            let id = newId(latitude: vertices.latitudes[i], longitude: vertices.longitudes[i], after: order.last)
+            order.append(id)
+        }
+        self.vertices = vertices
+        rebuild()
+    }
+
+    convenience init(polygon: NMAMapPolygon) {
+        self.init(vertices: polygon.vertexBuffer)
+    }
+
+    var count: Int {
+        return order.count
+    }
+
+    var triangleCount: Int {
+        return triangles.count / 3
+    }
+
+    /// Index buffer over ring positions, three per triangle.
+    func indices() -> [Int32] {
+        var position = [Int32](repeating: -1, count: xs.count)
+        for (index, id) in order.enumerated() {
+            position[Int(id)] = Int32(index)
+        }
+        return triangles.map { position[Int($0)] }
+    }
+
+    // MARK: Editing
+
+    func append(latitude: Double, longitude: Double) {
+        insert(latitude: latitude, longitude: longitude, at: count)
+    }
+
+    func insert(latitude: Double, longitude: Double, at index: Int) {
+        precondition(index >= 0 && index <= count, "PolygonTriangulation: index out of range")
+        let neighbor = count > 0 ? order[index > 0 ? index - 1 : count - 1] : nil
+        let id = newId(latitude: latitude, longitude: longitude, after: neighbor)
+        vertices.insert(latitude: latitude, longitude: longitude, at: index)
+        order.insert(id, at: index)
+        let n = count
+        guard n > 3 else {
+            lastEditWasLocal = false
+            rebuild()
+            return
+        }
+        let a = order[(index + n - 1) % n], b = order[(index + 1) % n]
+        lastEditWasLocal = retriangulate(around: [a, b], inserting: id, between: (a, b))
+        if !lastEditWasLocal {
+            rebuild()
+        }
+    }
+
+    func remove(at index: Int) {
+        precondition(index >= 0 && index < count, "PolygonTriangulation: index out of range")
+        let id = order[index]
+        let n = count
+        let a = order[(index + n - 1) % n], b = order[(index + 1) % n]
+        vertices.remove(at: index)
+        order.remove(at: index)
+        if n - 1 >= 3 {
+            lastEditWasLocal = retriangulate(around: [a, id, b], removing: id, between: (a, b))
+        } else {
+            lastEditWasLocal = false
+        }
+        if !lastEditWasLocal {
+            rebuild()
+        }
+        star[Int(id)] = []
+        freeIds.append(id)
+    }
+
+    fileprivate func newId(latitude: Double, longitude: Double, after neighbor: Int32?) -> Int32 {
+        var x = longitude
+        if let neighbor = neighbor {
+            x -= ((x - xs[Int(neighbor)]) / 360).rounded() * 360
+        }
+        if let id = freeIds.popLast() {
+            xs[Int(id)] = x
+            ys[Int(id)] = latitude
+            return id
+        }
+        xs.append(x)
+        ys.append(latitude)
+        star.append([])
+        return Int32(xs.count - 1)
+    }
+
+    // MARK: Local update
+
+    /// Re-triangulates the triangles around `centers` with `inserting` placed on edge
+    /// (a, b), or with `removing` taken out. Returns false, changing nothing, when the
+    /// local result would not be valid.
+    fileprivate func retriangulate(around centers: [Int32], inserting: Int32? = nil, removing: Int32? = nil,
+                                   between edge: (Int32, Int32)) -> Bool {
+        var cavity = Set<Int32>()
+        for center in centers {
+            cavity.formUnion(star[Int(center)])
+        }
+        guard !cavity.isEmpty, var loop = outline(of: cavity) else { return false }
+
+        if let v = inserting {
+            // The polygon edge a-b is on the outline in one direction or the other.
+            guard let position = loop.index(of: edge.0) else { return false }
+            let next = (position + 1) % loop.count, previous = (position + loop.count - 1) % loop.count
+            if loop[next] == edge.1 {
+                loop.insert(v, at: position + 1)
+            } else if loop[previous] == edge.1 {
+                loop.insert(v, at: position)
+            } else {
+                return false
+            }
+        } else if let v = removing {
+            guard let position = loop.index(of: v) else { return false }
+            loop.remove(at: position)
+        }
+        guard loop.count >= 3 else { return false }
+
+        let local = earcut(loop.map { xs[Int($0)] }, loop.map { ys[Int($0)] })
+        guard local.count == 3 * (loop.count - 2) else { return false }
+        var area = 0.0
+        for t in stride(from: 0, to: local.count, by: 3) {
+            area += abs(signedArea(loop[local[t]], loop[local[t + 1]], loop[local[t + 2]]))
+        }
+        let outlineArea = abs(ringArea(loop))
+        guard abs(area - outlineArea) <= 1e-9 * max(outlineArea, 1e-12) + 1e-18 else { return false }
+
+        // The changed region is the triangle a-v-b: nothing else in the cavity outline or
+        // outside the cavity may cut into it.
+        let v = inserting ?? removing!
+        let newEdges = inserting != nil ? [(edge.0, v), (v, edge.1)] : [(edge.0, edge.1)]
+        func cutsIn(_ p: Int32, _ q: Int32) -> Bool {
+            for (a, b) in newEdges where crosses(a, b, p, q) {
+                return true
+            }
+            return p != edge.0 && p != edge.1 && p != v && strictlyInside(p, edge.0, v, edge.1)
+        }
+        for i in 0..<loop.count where cutsIn(loop[i], loop[(i + 1) % loop.count]) {
+            return false
+        }
+        for t in 0..<triangleCount where !cavity.contains(Int32(t)) {
+            for k in 0..<3 where cutsIn(triangles[3 * t + k], triangles[3 * t + (k + 1) % 3]) {
+                return false
+            }
+        }
+
+        dropTriangles(cavity)
+        for t in stride(from: 0, to: local.count, by: 3) {
+            addTriangle(loop[local[t]], loop[local[t + 1]], loop[local[t + 2]])
+        }
+        return true
+    }
+
+    /// Boundary of a set of triangles as one closed counter-clockwise loop, or nil if the
+    /// set is not a disk.
+    fileprivate func outline(of cavity: Set<Int32>) -> [Int32]? {
+        var directed = Set<UInt64>()
+        for t in cavity {
+            for k in 0..<3 {
+                directed.insert(key(triangles[3 * Int(t) + k], triangles[3 * Int(t) + (k + 1) % 3]))
+            }
+        }
+        var next = [Int32: Int32]()
+        for edge in directed {
+            let from = Int32(truncatingBitPattern: edge >> 32), to = Int32(truncatingBitPattern: edge)
+            guard !directed.contains(key(to, from)) else { continue }
+            guard next[from] == nil else { return nil }
+            next[from] = to
+        }
+        guard let start = next.keys.first else { return nil }
+        var loop = [start]
+        var current = next[start]!
+        while current != start {
+            guard loop.count < next.count, let following = next[current] else { return nil }
+            loop.append(current)
+            current = following
+        }
+        return loop.count == next.count ? loop : nil
+    }
+
+    // MARK: Full rebuild
+
+    fileprivate func rebuild() {
+        triangles.removeAll(keepingCapacity: true)
+        for i in 0..<star.count {
+            star[i].removeAll()
+        }
+        guard order.count >= 3 else { return }
+        let local = earcut(order.map { xs[Int($0)] }, order.map { ys[Int($0)] })
+        for t in stride(from: 0, to: local.count, by: 3) {
+            addTriangle(order[local[t]], order[local[t + 1]], order[local[t + 2]])
+        }
+    }
+
+    fileprivate func addTriangle(_ a: Int32, _ b: Int32, _ c: Int32) {
+        let t = Int32(triangleCount)
+        // Stored counter-clockwise.
+        if signedArea(a, b, c) < 0 {
+            triangles.append(contentsOf: [a, c, b])
+        } else {
+            triangles.append(contentsOf: [a, b, c])
+        }
+        star[Int(a)].append(t)
+        star[Int(b)].append(t)
+        star[Int(c)].append(t)
+    }
+
+    /// Removes triangles by moving the last triangle into each freed slot.
+    fileprivate func dropTriangles(_ set: Set<Int32>) {
+        for t in set.sorted(by: >) {
+            let index = Int(t)
+            for k in 0..<3 {
+                let v = Int(triangles[3 * index + k])
+                if let position = star[v].index(of: t) {
+                    star[v].remove(at: position)
+                }
+            }
+            let last = triangleCount - 1
+            if index != last {
+                for k in 0..<3 {
+                    let v = triangles[3 * last + k]
+                    triangles[3 * index + k] = v
+                    if let position = star[Int(v)].index(of: Int32(last)) {
+                        star[Int(v)][position] = t
+                    }
+                }
+            }
+            triangles.removeLast(3)
+        }
+    }
+
+    // MARK: Geometry
+
+    fileprivate func key(_ from: Int32, _ to: Int32) -> UInt64 {
+        return UInt64(UInt32(bitPattern: from)) << 32 | UInt64(UInt32(bitPattern: to))
+    }
+
+    fileprivate func signedArea(_ a: Int32, _ b: Int32, _ c: Int32) -> Double {
+        let ax = xs[Int(a)], ay = ys[Int(a)]
+        return ((xs[Int(b)] - ax) * (ys[Int(c)] - ay) - (ys[Int(b)] - ay) * (xs[Int(c)] - ax)) / 2
+    }
+
+    fileprivate func ringArea(_ ring: [Int32]) -> Double {
+        var area = 0.0
+        for i in 0..<ring.count {
+            let a = Int(ring[i]), b = Int(ring[(i + 1) % ring.count])
+            area += xs[a] * ys[b] - xs[b] * ys[a]
+        }
+        return area / 2
+    }
+
+    /// Proper crossing of segments a-b and p-q (shared endpoints don't count).
+    fileprivate func crosses(_ a: Int32, _ b: Int32, _ p: Int32, _ q: Int32) -> Bool {
+        if a == p || a == q || b == p || b == q {
+            return false
+        }
+        let d1 = signedArea(a, b, p), d2 = signedArea(a, b, q)
+        let d3 = signedArea(p, q, a), d4 = signedArea(p, q, b)
+        return ((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0))
+    }
+
+    fileprivate func strictlyInside(_ p: Int32, _ a: Int32, _ b: Int32, _ c: Int32) -> Bool {
+        let orientation = signedArea(a, b, c)
+        guard orientation != 0 else { return false }
+        let s1 = signedArea(a, b, p) * orientation, s2 = signedArea(b, c, p) * orientation, s3 = signedArea(c, a, p) * orientation
+        return s1 > 0 && s2 > 0 && s3 > 0
+    }
+
+    /// Ear clipping of a simple ring; returns positions into the ring, three per triangle.
+    /// Returns fewer triangles than `count - 2` if the ring is not simple.
+    fileprivate func earcut(_ ringX: [Double], _ ringY: [Double]) -> [Int] {
+        let n = ringX.count
+        guard n >= 3 else { return [] }
+        var area = 0.0
+        for i in 0..<n {
+            let j = (i + 1) % n
+            area += ringX[i] * ringY[j] - ringX[j] * ringY[i]
+        }
+        // Walk counter-clockwise.
+        var next = [Int](repeating: 0, count: n), previous = [Int](repeating: 0, count: n)
+        for i in 0..<n {
+            if area >= 0 {
+                next[i] = (i + 1) % n
+                previous[i] = (i + n - 1) % n
+            } else {
+                next[i] = (i + n - 1) % n
+                previous[i] = (i + 1) % n
+            }
+        }
+        func cross(_ a: Int, _ b: Int, _ c: Int) -> Double {
+            return (ringX[b] - ringX[a]) * (ringY[c] - ringY[a]) - (ringY[b] - ringY[a]) * (ringX[c] - ringX[a])
+        }
+        func isEar(_ ear: Int) -> Bool {
+            let a = previous[ear], c = next[ear]
+            guard cross(a, ear, c) > 0 else { return false }
+            var p = next[c]
+            while p != a {
+                // Only reflex or collinear vertices can lie inside a convex ear.
+                if cross(previous[p], p, next[p]) <= 0 &&
+                    cross(a, ear, p) >= 0 && cross(ear, c, p) >= 0 && cross(c, a, p) >= 0 &&
+                    !(ringX[p] == ringX[a] && ringY[p] == ringY[a]) && !(ringX[p] == ringX[c] && ringY[p] == ringY[c]) {
+                    return false
+                }
+                p = next[p]
+            }
+            return true
+        }
+
+        var result = [Int]()
+        result.reserveCapacity(3 * (n - 2))
+        var remaining = n
+        var ear = 0
+        var stop = ear
+        while remaining > 3 {
+            if isEar(ear) {
+                let a = previous[ear], c = next[ear]
+                result.append(contentsOf: [a, ear, c])
+                next[a] = c
+                previous[c] = a
+                remaining -= 1
+                ear = c
+                stop = c
+            } else {
+                ear = next[ear]
+                if ear == stop {
+                    return result
+                }
+            }
+        }
+        result.append(contentsOf: [previous[ear], ear, next[ear]])
+        return result
+    }
+}
@@ -0,0 +1,249 @@
+//
+//  PolylineLODPyramid.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import UIKit
+
+/// Per-zoom simplified versions of a long polyline (GPS track, long route).
+///
+/// One Douglas-Peucker pass in Web Mercator records, for every vertex, the largest
+/// tolerance at which it is still kept (clamped to its parent's, so levels nest). The level
+/// for zoom `z` is then just the vertices whose importance reaches `tolerance` points at
+/// that zoom; levels are built on first use and cached.
+///
+/// Appends stay cheap: the line is simplified in independent runs of `chunkSize` vertices
+/// whose end vertices are always kept, so an append only redoes the open last run, and
+/// cached levels only extend past their last closed run.
+final class PolylineLODPyramid {
+
+    static let chunkSize = 1024
+
+    /// Maximum deviation of a level from the full line, in screen points.
+    let tolerance: Double
+    /// Zooms past this draw the full line.
+    let maxZoom: Int
+
+    fileprivate(set) var vertices: GeoCoordinateBuffer
+    fileprivate var xs: [Double] = []
+    fileprivate var ys: [Double] = []
+    fileprivate var importance: [Double] = []
+    /// Vertices before this index have final importance.
+    fileprivate var settledCount = 0
+    fileprivate var levels: [Int: (indices: [Int32], covered: Int)] = [:]
+
+    /// Line style copied onto the polylines built by `update(_:)`.
+    var lineColor: UIColor?
+    var lineWidth: UInt = 0
+    var zIndex: UInt = 0
+
+    fileprivate var displayed: NMAMapPolyline?
+    fileprivate var displayedZoom = -1
+    fileprivate var displayedCount = 0
+    /// Vertex indices on the shown polyline; empty past `maxZoom`, where it is the full line.
+    fileprivate var displayedIndices: [Int32] = []
+
+    init(vertices: GeoCoordinateBuffer = GeoCoordinateBuffer(), tolerance: Double = 1, maxZoom: Int = 20) {
+        self.vertices = GeoCoordinateBuffer(capacity: vertices.count)
+        self.tolerance = tolerance
+        self.maxZoom = maxZoom
+        append(contentsOf: vertices)
+    }
+
+    var count: Int {
+        return vertices.count
+    }
+
+    // MARK: Editing
+
+    func append(latitude: Double, longitude: Double, altitude: Float = 0) {
+        var x = MercatorProjection.mercatorX(longitude: longitude)
+        if let previous = xs.last {
+            x -= (x - previous).rounded()
+        }
+        vertices.append(latitude: latitude, longitude: longitude, altitude: altitude)
+        xs.append(x)
+        ys.append(MercatorProjection.mercatorY(latitude: latitude))
+        importance.append(.infinity)
+    }
+
+    func append(_ coordinates: NMAGeoCoordinates) {
+        append(latitude: coordinates.latitude, longitude: coordinates.longitude, altitude: Float(coordinates.altitude))
+    }
+
+    func append(contentsOf other: GeoCoordinateBuffer) {
+        xs.reserveCapacity(count + other.count)
+        ys.reserveCapacity(count + other.count)
+        importance.reserveCapacity(count + other.count)
+        for i in 0..<other.count {
+            append(latitude: other.latitudes[i], longitude: other.longitudes[i], altitude: other.altitudes[i])
+        }
+    }
+
+    // MARK: Levels
+
+    /// Mercator tolerance of the level drawn at `zoomLevel`.
+    func mercatorTolerance(forZoom zoom: Int) -> Double {
+        return tolerance / (256 * pow(2, Double(zoom)))
+    }
+
+    /// Vertex indices kept at `zoomLevel`, in order.
+    func indices(forZoomLevel zoomLevel: Float) -> [Int32] {
+        let zoom = Int(zoomLevel.rounded(.down))
+        guard zoom <= maxZoom else { return (0..<count).map { Int32($0) } }
+        settle()
+        let threshold = mercatorTolerance(forZoom: max(zoom, 0))
+        var level = levels[zoom] ?? (indices: [], covered: 0)
+        var result = level.indices
+        for i in level.covered..<count where importance[i] >= threshold {
+            result.append(Int32(i))
+        }
+
+        // Cache everything before the open run.
+        let closed = settledCount
+        level.covered = closed
+        level.indices = result
+        while let last = level.indices.last, Int(last) >= closed {
+            level.indices.removeLast()
+        }
+        levels[zoom] = level
+        return result
+    }
+
+    func vertices(forZoomLevel zoomLevel: Float) -> GeoCoordinateBuffer {
+        return vertices(at: indices(forZoomLevel: zoomLevel))
+    }
+
+    fileprivate func vertices(at kept: [Int32]) -> GeoCoordinateBuffer {
+        var result = GeoCoordinateBuffer(capacity: kept.count)
+        for i in kept {
+            let index = Int(i)
+            result.append(latitude: vertices.latitudes[index], longitude: vertices.longitudes[index], altitude: vertices.altitudes[index])
+        }
+        return result
+    }
+
+    /// Shows the level for the map's current zoom. The polyline is replaced only when the
+    /// zoom level changes; appends at the same zoom edit the shown polyline in place, dropping
+    /// the trailing vertices that left the level and appending the new ones.
+    func update(_ mapView: NMAMapView) {
+        let zoom = min(Int(mapView.zoomLevel.rounded(.down)), maxZoom + 1)
+        guard zoom != displayedZoom || count != displayedCount else { return }
+        if zoom > maxZoom {
+            if zoom == displayedZoom, let polyline = displayed {
+                for i in displayedCount..<count {
+                    polyline.append(vertices.geoCoordinates(at: i))
+                }
+            } else {
+                show(vertices, zoom: zoom, in: mapView)
+            }
+            displayedIndices = []
+            displayedCount = count
+            return
+        }
+
+        let kept = indices(forZoomLevel: Float(zoom))
+        if zoom == displayedZoom, let polyline = displayed {
+            // Vertices in closed runs never leave a level, so only the tail can differ.
+            var common = 0
+            let shared = min(kept.count, displayedIndices.count)
+            while common < shared && kept[common] == displayedIndices[common] {
+                common += 1
+            }
+            let removed = displayedIndices.count - common
+            if removed + (kept.count - common) < kept.count {
+                for _ in 0..<removed {
+                    polyline.removeLastVertex()
+                }
+                for i in kept[common..<kept.count] {
+                    polyline.append(vertices.geoCoordinates(at: Int(i)))
+                }
+                displayedIndices = kept
+                displayedCount = count
+                return
+            }
+        }
+        show(vertices(at: kept), zoom: zoom, in: mapView)
+        displayedIndices = kept
+        displayedCount = count
+    }
+
+    func remove(from mapView: NMAMapView) {
+        if let old = displayed {
+            mapView.remove(old)
+        }
+        displayed = nil
+        displayedZoom = -1
+        displayedIndices = []
+    }
+
+    /// Replaces the shown polyline with a new one over `buffer`.
+    fileprivate func show(_ buffer: GeoCoordinateBuffer, zoom: Int, in mapView: NMAMapView) {
+        let polyline = NMAMapPolyline(buffer: buffer)
+        if let color = lineColor {
+            polyline.lineColor = color
+        }
+        if lineWidth > 0 {
+            polyline.lineWidth = lineWidth
+        }
+        polyline.zIndex = zIndex
+
+        let renderAllowed = mapView.renderAllowed
+        mapView.renderAllowed = false
+        if let old = displayed {
+            mapView.remove(old)
+        }
+        mapView.add(polyline)
+        mapView.renderAllowed = renderAllowed
+        displayed = polyline
+        displayedZoom = zoom
+    }
+
+    // MARK: Simplification
+
+    /// Recomputes importance from the first unsettled run to the end.
+    fileprivate func settle() {
+        let chunk = PolylineLODPyramid.chunkSize
+        var start = settledCount / chunk * chunk
+        while start < count - 1 {
+            let end = min(start + chunk, count - 1)
+            simplify(from: start, to: end)
+            if end == start + chunk {
+                settledCount = end
+            }
+            start = end
+        }
+    }
+
+    /// Douglas-Peucker over `first...last`, storing each vertex's importance.
+    fileprivate func simplify(from first: Int, to last: Int) {
+        importance[first] = .infinity
+        importance[last] = .infinity
+        var stack = [(first: first, last: last, limit: Double.infinity)]
+        while let span = stack.popLast() {
+            guard span.last - span.first > 1 else { continue }
+            let x0 = xs[span.first], y0 = ys[span.first]
+            let dx = xs[span.last] - x0, dy = ys[span.last] - y0
+            let lengthSquared = dx * dx + dy * dy
+            var farthest = span.first + 1
+            var farthestSquared = -1.0
+            for i in (span.first + 1)..<span.last {
+                let px = xs[i] - x0, py = ys[i] - y0
+                let t = lengthSquared > 0 ? min(max((px * dx + py * dy) / lengthSquared, 0), 1) : 0
+                let ex = px - t * dx, ey = py - t * dy
+                let squared = ex * ex + ey * ey
+                if squared > farthestSquared {
+                    farthestSquared = squared
+                    farthest = i
+                }
+            }
+            let value = min(sqrt(farthestSquared), span.limit)
+            importance[farthest] = value
+            stack.append((first: span.first, last: farthest, limit: value))
+            stack.append((first: farthest, last: span.last, limit: value))
+        }
+    }
+}
@@ -0,0 +1,264 @@
+//
+//  PolylineSegmentIndex.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+
+/// Closest point of a polyline to a query point.
+struct PolylineSnap {
+    /// Index of the segment's first vertex.
+    let segment: Int
+    /// Position along the segment, 0 at `segment`, 1 at `segment + 1`.
+    let fraction: Double
+    let coordinates: NMAGeoCoordinates
+    /// Meters from the query point.
+    let distance: Double
+    /// Meters from the first vertex, along the line.
+    let distanceAlongLine: Double
+}
+
+/// Segment index for snapping to a polyline, replacing the linear
+/// `NMAMapPolyline.nearestVertex(to:)` / `indexOfNearestVertex(to:)` scans.
+///
+/// Vertices are stored as unit vectors, so straight-line (chord) distance orders points
+/// exactly like great-circle distance and the date line needs no special case. Segments are
+/// grouped in sequence order into a tree of `nodeSize`-wide bounding boxes; consecutive
+/// segments of a track are close together, so this packs as well as a spatial sort, and an
+/// append only grows the boxes on the rightmost path (O(log n)). Queries run best-first over
+/// the boxes. Cumulative lengths make `distanceAlongLine` and `coordinates(atDistance:)` cheap.
+///
+/// Nearest points are computed on the chord between vertices, which is within millimeters
+/// of the great circle for segments up to a few kilometers.
+final class PolylineSegmentIndex {
+
+    static let nodeSize = 16
+
+    fileprivate(set) var vertices = GeoCoordinateBuffer()
+    /// Unit vectors, three values per vertex.
+    fileprivate var points: [Double] = []
+    /// Meters from the first vertex to each vertex.
+    fileprivate var cumulative: [Double] = []
+    /// Boxes (minX, minY, minZ, maxX, maxY, maxZ) per node; `levels[0]` holds one per
+    /// segment and the last level always holds exactly one node.
+    fileprivate var levels: [[Double]] = [[]]
+
+    init(vertices: GeoCoordinateBuffer = GeoCoordinateBuffer()) {
+        for i in 0..<vertices.count {
+            append(latitude: vertices.latitudes[i], longitude: vertices.longitudes[i], altitude: vertices.altitudes[i])
+        }
+    }
+
+    convenience init(polyline: NMAMapPolyline) {
+        self.init(vertices: polyline.vertexBuffer)
+    }
+
+    var count: Int {
+        return vertices.count
+    }
+
+    /// Length of the line in meters.
+    var length: Double {
+        return cumulative.last ?? 0
+    }
+
+    // MARK: Editing
+
+    /// Adds a vertex at the end; mirror `NMAMapPolyline.append(_:)` calls here.
+    func append(latitude: Double, longitude: Double, altitude: Float = 0) {
+        let phi = latitude * GeoBatch.degreesToRadians, lambda = longitude * GeoBatch.degreesToRadians
+        points.append(cos(phi) * cos(lambda))
+        points.append(cos(phi) * sin(lambda))
+        points.append(sin(phi))
+        if let last = cumulative.last {
+            let previous = vertices.count - 1
+            cumulative.append(last + GeoBatch.distance(fromLatitude: vertices.latitudes[previous], longitude: vertices.longitudes[previous],
+                                                       toLatitude: latitude, longitude: longitude))
+        } else {
+            cumulative.append(0)
+        }
+        vertices.append(latitude: latitude, longitude: longitude, altitude: altitude)
+
+        let count = vertices.count
+        if count >= 2 {
+            var box = [Double](repeating: 0, count: 6)
+            for axis in 0..<3 {
+                let a = points[3 * (count - 2) + axis], b = points[3 * (count - 1) + axis]
+                box[axis] = min(a, b)
+                box[axis + 3] = max(a, b)
+            }
+            insert(box, at: count - 2, level: 0)
+        }
+    }
+
+    func append(_ coordinates: NMAGeoCoordinates) {
+        append(latitude: coordinates.latitude, longitude: coordinates.longitude, altitude: Float(coordinates.altitude))
+    }
+
+    /// Appends or grows node `index` of `level` and its ancestors.
+    fileprivate func insert(_ box: [Double], at index: Int, level: Int) {
+        if index * 6 == levels[level].count {
+            levels[level].append(contentsOf: box)
+        } else {
+            for axis in 0..<3 {
+                levels[level][index * 6 + axis] = min(levels[level][index * 6 + axis], box[axis])
+                levels[level][index * 6 + axis + 3] = max(levels[level][index * 6 + axis + 3], box[axis + 3])
+            }
+        }
+        if level == levels.count - 1 {
+            // The top level just got its second node: add a root above it.
+            guard levels[level].count > 6 else { return }
+            levels.append([])
+            insert(Array(levels[level][0..<6]), at: 0, level: level + 1)
+        }
+        insert(box, at: index / PolylineSegmentIndex.nodeSize, level: level + 1)
+    }
+
+    // MARK: Queries
+
+    /// Index of the vertex closest to the point.
+    func nearestVertex(toLatitude latitude: Double, longitude: Double) -> Int? {
+        guard count > 0 else { return nil }
+        guard count > 1 else { return 0 }
+        let q = PolylineSegmentIndex.unitVector(latitude: latitude, longitude: longitude)
+        return search(q) { segment in
+            let first = distanceSquared(q, vertex: segment), second = distanceSquared(q, vertex: segment + 1)
+            return first <= second ? (segment, first) : (segment + 1, second)
+        }
+    }
+
+    func nearestVertex(to coordinates: NMAGeoCoordinates) -> Int? {
+        return nearestVertex(toLatitude: coordinates.latitude, longitude: coordinates.longitude)
+    }
+
+    /// Closest point on the line to the point.
+    func nearestPoint(toLatitude latitude: Double, longitude: Double) -> PolylineSnap? {
+        guard count > 0 else { return nil }
+        let q = PolylineSegmentIndex.unitVector(latitude: latitude, longitude: longitude)
+        if count == 1 {
+            return snap(segment: 0, fraction: 0, latitude: latitude, longitude: longitude)
+        }
+        var fractions = [Int: Double]()
+        guard let segment = search(q, exact: { segment -> (Int, Double) in
+            let (fraction, squared) = self.project(q, onSegment: segment)
+            fractions[segment] = fraction
+            return (segment, squared)
+        }) else { return nil }
+        return snap(segment: segment, fraction: fractions[segment] ?? 0, latitude: latitude, longitude: longitude)
+    }
+
+    func nearestPoint(to coordinates: NMAGeoCoordinates) -> PolylineSnap? {
+        return nearestPoint(toLatitude: coordinates.latitude, longitude: coordinates.longitude)
+    }
+
+    /// Meters from the first vertex to `fraction` of the way along `segment`.
+    func distanceAlongLine(segment: Int, fraction: Double = 0) -> Double {
+        guard segment + 1 < count else { return length }
+        return cumulative[segment] + fraction * (cumulative[segment + 1] - cumulative[segment])
+    }
+
+    /// Point `distance` meters along the line from the first vertex (clamped to the ends).
+    func coordinates(atDistance distance: Double) -> NMAGeoCoordinates? {
+        guard count > 0 else { return nil }
+        var low = 0, high = count - 1
+        while high - low > 1 {
+            let middle = (low + high) / 2
+            if cumulative[middle] <= distance {
+                low = middle
+            } else {
+                high = middle
+            }
+        }
+        let span = cumulative[high] - cumulative[low]
+        let fraction = span > 0 ? min(max((distance - cumulative[low]) / span, 0), 1) : 0
+        return pointOn(segment: low, fraction: fraction)
+    }
+
+    // MARK: Search
+
+    /// Best-first search for the segment minimizing `exact`, which returns a result index
+    /// and a squared chord distance never below the segment box's.
+    fileprivate func search(_ q: [Double], exact: (Int) -> (Int, Double)) -> Int? {
+        var queue = NodeQueue()
+        let top = levels.count - 1
+        queue.push(node: 0, level: top, distance: boxDistanceSquared(q, level: top, node: 0))
+        while let entry = queue.pop() {
+            if entry.level < 0 {
+                return entry.node
+            }
+            if entry.level == 0 {
+                let (result, squared) = exact(entry.node)
+                queue.push(node: result, level: -1, distance: squared)
+                continue
+            }
+            let childLevel = entry.level - 1
+            let first = entry.node * PolylineSegmentIndex.nodeSize
+            let last = min(first + PolylineSegmentIndex.nodeSize, levels[childLevel].count / 6)
+            for child in first..<last {
+                queue.push(node: child, level: childLevel, distance: boxDistanceSquared(q, level: childLevel, node: child))
+            }
+        }
+        return nil
+    }
+
+    fileprivate func boxDistanceSquared(_ q: [Double], level: Int, node: Int) -> Double {
+        var total = 0.0
+        for axis in 0..<3 {
+            let low = levels[level][node * 6 + axis], high = levels[level][node * 6 + axis + 3]
+            let d = max(low - q[axis], 0, q[axis] - high)
+            total += d * d
+        }
+        return total
+    }
+
+    fileprivate func distanceSquared(_ q: [Double], vertex: Int) -> Double {
+        let dx = points[3 * vertex] - q[0], dy = points[3 * vertex + 1] - q[1], dz = points[3 * vertex + 2] - q[2]
+        return dx * dx + dy * dy + dz * dz
+    }
+
+    /// Fraction along the chord of `segment` closest to `q`, and the squared distance to it.
+    fileprivate func project(_ q: [Double], onSegment segment: Int) -> (Double, Double) {
+        let a = 3 * segment, b = a + 3
+        var dot = 0.0, lengthSquared = 0.0
+        for axis in 0..<3 {
+            let d = points[b + axis] - points[a + axis]
+            dot += (q[axis] - points[a + axis]) * d
+            lengthSquared += d * d
+        }
+        let t = lengthSquared > 0 ? min(max(dot / lengthSquared, 0), 1) : 0
+        var squared = 0.0
+        for axis in 0..<3 {
+            let c = points[a + axis] + t * (points[b + axis] - points[a + axis])
+            squared += (q[axis] - c) * (q[axis] - c)
+        }
+        return (t, squared)
+    }
+
+    fileprivate func pointOn(segment: Int, fraction: Double) -> NMAGeoCoordinates {
+        guard segment + 1 < count, fraction > 0 else {
+            return vertices.geoCoordinates(at: min(segment, count - 1))
+        }
+        let a = 3 * segment, b = a + 3
+        let x = points[a] + fraction * (points[b] - points[a])
+        let y = points[a + 1] + fraction * (points[b + 1] - points[a + 1])
+        let z = points[a + 2] + fraction * (points[b + 2] - points[a + 2])
+        return NMAGeoCoordinates(latitude: atan2(z, sqrt(x * x + y * y)) * GeoBatch.radiansToDegrees,
+                                 longitude: atan2(y, x) * GeoBatch.radiansToDegrees)
+    }
+
+    fileprivate func snap(segment: Int, fraction: Double, latitude: Double, longitude: Double) -> PolylineSnap {
+        let point = pointOn(segment: segment, fraction: fraction)
+        return PolylineSnap(segment: segment, fraction: fraction, coordinates: point,
+                            distance: GeoBatch.distance(fromLatitude: latitude, longitude: longitude,
+                                                        toLatitude: point.latitude, longitude: point.longitude),
+                            distanceAlongLine: distanceAlongLine(segment: segment, fraction: fraction))
+    }
+
+    fileprivate static func unitVector(latitude: Double, longitude: Double) -> [Double] {
+        let phi = latitude * GeoBatch.degreesToRadians, lambda = longitude * GeoBatch.degreesToRadians
+        return [cos(phi) * cos(lambda), cos(phi) * sin(lambda), sin(phi)]
+    }
+}
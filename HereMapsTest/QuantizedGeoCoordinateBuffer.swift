@@ -0,0 +1,144 @@
+//
+//  QuantizedGeoCoordinateBuffer.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+import Accelerate
+
+/// Fixed-point variant of `GeoCoordinateBuffer` for large, mostly read-only geometry
+/// (route shapes, POI datasets, overlays).
+///
+/// Latitude and longitude are stored as `Int32` in units of 1e-7 degree (about 1 cm),
+/// which is finer than the six decimal places `NMAGeoCoordinates` guarantees and
+/// halves the size of the coordinate arrays. Round-trips are lossless at that
+/// precision: `quantize(dequantize(q)) == q` for every stored value.
+struct QuantizedGeoCoordinateBuffer {
+
+    /// Fixed-point units per degree.
+    static let scale: Double = 10_000_000
+
+    fileprivate(set) var latitudes: [Int32]
+    fileprivate(set) var longitudes: [Int32]
+    fileprivate(set) var altitudes: [Float]
+
+    var count: Int {
+        return latitudes.count
+    }
+
+    var isEmpty: Bool {
+        return latitudes.isEmpty
+    }
+
+    /// Bytes used by the coordinate arrays, for overlay memory accounting.
+    var byteCount: Int {
+        return count * (2 * MemoryLayout<Int32>.size + MemoryLayout<Float>.size)
+    }
+
+    init() {
+        latitudes = []
+        longitudes = []
+        altitudes = []
+    }
+
+    /// Narrows a double precision buffer, rounding to the nearest 1e-7 degree.
+    init(_ buffer: GeoCoordinateBuffer) {
+        var latitudes = [Int32](repeating: 0, count: buffer.count)
+        var longitudes = [Int32](repeating: 0, count: buffer.count)
+        buffer.withUnsafeBuffers { lats, lons, _ in
+            latitudes.withUnsafeMutableBufferPointer { QuantizedGeoCoordinateBuffer.narrow(lats, into: $0) }
+            longitudes.withUnsafeMutableBufferPointer { QuantizedGeoCoordinateBuffer.narrow(lons, into: $0) }
+        }
+        self.latitudes = latitudes
+        self.longitudes = longitudes
+        self.altitudes = buffer.altitudes
+    }
+
+    mutating func append(latitude: Double, longitude: Double, altitude: Float = 0) {
+        latitudes.append(QuantizedGeoCoordinateBuffer.quantize(latitude))
+        longitudes.append(QuantizedGeoCoordinateBuffer.quantize(longitude))
+        altitudes.append(altitude)
+    }
+
+    mutating func reserveCapacity(_ capacity: Int) {
+        latitudes.reserveCapacity(capacity)
+        longitudes.reserveCapacity(capacity)
+        altitudes.reserveCapacity(capacity)
+    }
+
+    func latitude(at index: Int) -> Double {
+        return QuantizedGeoCoordinateBuffer.dequantize(latitudes[index])
+    }
+
+    func longitude(at index: Int) -> Double {
+        return QuantizedGeoCoordinateBuffer.dequantize(longitudes[index])
+    }
+
+    func geoCoordinates(at index: Int) -> NMAGeoCoordinates {
+        return NMAGeoCoordinates(latitude: latitude(at: index), longitude: longitude(at: index), altitude: Double(altitudes[index]))
+    }
+
+    /// Widens back to double precision for batch kernels that work in degrees.
+    func dequantized() -> GeoCoordinateBuffer {
+        var lats = [Double](repeating: 0, count: count)
+        var lons = [Double](repeating: 0, count: count)
+        latitudes.withUnsafeBufferPointer { source in
+            lats.withUnsafeMutableBufferPointer { QuantizedGeoCoordinateBuffer.widen(source, into: $0) }
+        }
+        longitudes.withUnsafeBufferPointer { source in
+            lons.withUnsafeMutableBufferPointer { QuantizedGeoCoordinateBuffer.widen(source, into: $0) }
+        }
+        return GeoCoordinateBuffer(latitudes: lats, longitudes: lons, altitudes: altitudes)
+    }
+
+    // MARK: Conversion kernels
+
+    /// Degrees to fixed point, rounding ties to even like `vDSP_vfixr32D` in `narrow`.
+    static func quantize(_ degrees: Double) -> Int32 {
+        precondition(degrees >= -180 && degrees <= 180, "QuantizedGeoCoordinateBuffer: coordinate out of range")
+        return Int32((degrees * scale).rounded(.toNearestOrEven))
+    }
+
+    static func dequantize(_ value: Int32) -> Double {
+        return Double(value) / scale
+    }
+
+    /// Degrees to fixed point, vectorized with vDSP (round to nearest, ties to even).
+    static func narrow(_ source: UnsafeBufferPointer<Double>, into destination: UnsafeMutableBufferPointer<Int32>) {
+        precondition(destination.count >= source.count, "QuantizedGeoCoordinateBuffer: destination too small")
+        guard let src = source.baseAddress, let dst = destination.baseAddress, source.count > 0 else { return }
+        let chunkSize = 1024
+        var factor = scale
+        var scratch = [Double](repeating: 0, count: min(chunkSize, source.count))
+        scratch.withUnsafeMutableBufferPointer { buffer in
+            let scaled = buffer.baseAddress!
+            var offset = 0
+            while offset < source.count {
+                let n = vDSP_Length(min(chunkSize, source.count - offset))
+                vDSP_vsmulD(src + offset, 1, &factor, scaled, 1, n)
+                vDSP_vfixr32D(scaled, 1, dst + offset, 1, n)
+                offset += chunkSize
+            }
+        }
+    }
+
+    /// Fixed point to degrees, vectorized with vDSP. Divides rather than multiplies by
+    /// 1e-7 so every value is the correctly rounded double and narrows back exactly.
+    static func widen(_ source: UnsafeBufferPointer<Int32>, into destination: UnsafeMutableBufferPointer<Double>) {
+        precondition(destination.count >= source.count, "QuantizedGeoCoordinateBuffer: destination too small")
+        guard let src = source.baseAddress, let dst = destination.baseAddress else { return }
+        var divisor = scale
+        let n = vDSP_Length(source.count)
+        vDSP_vflt32D(src, 1, dst, 1, n)
+        vDSP_vsdivD(dst, 1, &divisor, dst, 1, n)
+    }
+}
+
+extension GeoCoordinateBuffer {
+    init(_ quantized: QuantizedGeoCoordinateBuffer) {
+        self = quantized.dequantized()
+    }
+}
@@ -0,0 +1,240 @@
+//
+//  TextLayoutCache.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import UIKit
+
+/// Measured, wrapped text.
+struct TextLayout {
+    /// Bounding size, rounded up to whole points.
+    let size: CGSize
+    let lineCount: Int
+}
+
+/// LRU cache of text layouts keyed by string, font and wrapping width, for info bubble
+/// labels.
+///
+/// Measuring goes through `NSString.boundingRect(with:options:attributes:context:)`, which
+/// is safe off the main thread, so `prefetch` can lay out the bubbles for a batch of
+/// markers in the background; showing a bubble then only costs a lookup. The cache holds at
+/// most `capacity` layouts and drops the least recently used one first (a hash map over an
+/// intrusive doubly linked list, O(1) per lookup). All methods are thread-safe.
+final class TextLayoutCache {
+
+    static let shared = TextLayoutCache()
+
+    let capacity: Int
+
+    fileprivate struct Key: Hashable {
+        let text: String
+        let fontName: String
+        let pointSize: CGFloat
+        let width: CGFloat
+
+        var hashValue: Int {
+            return text.hashValue ^ fontName.hashValue &* 31 ^ pointSize.hashValue &* 17 ^ width.hashValue
+        }
+
+        static func == (lhs: Key, rhs: Key) -> Bool {
+            return lhs.width == rhs.width && lhs.pointSize == rhs.pointSize && lhs.fontName == rhs.fontName && lhs.text == rhs.text
+        }
+    }
+
+    fileprivate var nodes: [Key: Int] = [:]
+    fileprivate var keys: [Key?] = []
+    fileprivate var layouts: [TextLayout] = []
+    /// Recency list: `head` is the most recently used node.
+    fileprivate var previous: [Int] = []
+    fileprivate var next: [Int] = []
+    fileprivate var head = -1
+    fileprivate var tail = -1
+    fileprivate let lock = NSLock()
+    fileprivate let queue = DispatchQueue(label: "TextLayoutCache", qos: .userInitiated, attributes: .concurrent)
+
+    init(capacity: Int = 1024) {
+        precondition(capacity > 0, "TextLayoutCache: capacity must be positive")
+        self.capacity = capacity
+    }
+
+    var count: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return nodes.count
+    }
+
+    // MARK: Layout
+
+    /// Width the cache wraps at for `width`: widths within half a point share an entry, so
+    /// they are rounded down to it. Lay the text out at this width too.
+    static func layoutWidth(_ width: CGFloat) -> CGFloat {
+        return (width * 2).rounded(.down) / 2
+    }
+
+    /// Layout of `text` wrapped at `layoutWidth(width)` points, measured on a miss.
+    func layout(for text: String, font: UIFont, width: CGFloat) -> TextLayout {
+        let key = Key(text: text, fontName: font.fontName, pointSize: font.pointSize, width: TextLayoutCache.layoutWidth(width))
+        lock.lock()
+        if let node = nodes[key] {
+            touch(node)
+            let layout = layouts[node]
+            lock.unlock()
+            return layout
+        }
+        lock.unlock()
+
+        // Measure outside the lock; a concurrent miss on the same key just measures twice.
+        let layout = TextLayoutCache.measure(text, font: font, width: key.width)
+        lock.lock()
+        insert(key, layout)
+        lock.unlock()
+        return layout
+    }
+
+    /// Measures `texts` in the background and calls `completion` on the main queue.
+    func prefetch(_ texts: [String], font: UIFont, width: CGFloat, completion: (() -> Void)? = nil) {
+        queue.async {
+            for text in texts {
+                _ = self.layout(for: text, font: font, width: width)
+            }
+            if let completion = completion {
+                DispatchQueue.main.async(execute: completion)
+            }
+        }
+    }
+
+    func removeAll() {
+        lock.lock()
+        defer { lock.unlock() }
+        nodes = [:]
+        keys = []
+        layouts = []
+        previous = []
+        next = []
+        head = -1
+        tail = -1
+    }
+
+    fileprivate static func measure(_ text: String, font: UIFont, width: CGFloat) -> TextLayout {
+        guard !text.isEmpty else { return TextLayout(size: .zero, lineCount: 0) }
+        let bounds = (text as NSString).boundingRect(with: CGSize(width: width, height: .greatestFiniteMagnitude),
+                                                     options: [.usesLineFragmentOrigin, .usesFontLeading],
+                                                     attributes: [NSFontAttributeName: font], context: nil)
+        let size = CGSize(width: ceil(bounds.width), height: ceil(bounds.height))
+        return TextLayout(size: size, lineCount: max(Int((bounds.height / font.lineHeight).rounded()), 1))
+    }
+
+    // MARK: LRU list (under the lock)
+
+    fileprivate func insert(_ key: Key, _ layout: TextLayout) {
+        if let node = nodes[key] {
+            layouts[node] = layout
+            touch(node)
+            return
+        }
+        let node: Int
+        if keys.count < capacity {
+            node = keys.count
+            keys.append(key)
+            layouts.append(layout)
+            previous.append(-1)
+            next.append(-1)
+        } else {
+            // Reuse the least recently used node.
+            node = tail
+            unlink(node)
+            nodes[keys[node]!] = nil
+            keys[node] = key
+            layouts[node] = layout
+        }
+        nodes[key] = node
+        pushFront(node)
+    }
+
+    fileprivate func touch(_ node: Int) {
+        guard node != head else { return }
+        unlink(node)
+        pushFront(node)
+    }
+
+    fileprivate func unlink(_ node: Int) {
+        let before = previous[node], after = next[node]
+        if before >= 0 {
+            next[before] = after
+        } else {
+            head = after
+        }
+        if after >= 0 {
+            previous[after] = before
+        } else {
+            tail = before
+        }
+        previous[node] = -1
+        next[node] = -1
+    }
+
+    fileprivate func pushFront(_ node: Int) {
+        next[node] = head
+        previous[node] = -1
+        if head >= 0 {
+            previous[head] = node
+        }
+        head = node
+        if tail < 0 {
+            tail = node
+        }
+    }
+}
+
+// MARK: Info bubbles
+
+extension NMAMapInfoBubbleCustomizationContext {
+    /// Width available to the bubble's labels.
+    var labelWidth: CGFloat {
+        return max(bubbleMaxWidth - 2 * (bubblePadding + bubbleLeftRightMargin), 1)
+    }
+
+    /// Sets the title and description labels with sizes from `cache`, so the labels don't
+    /// measure their text again when the bubble is shown.
+    func applyLayout(title: String?, description: String?, cache: TextLayoutCache = .shared) {
+        let width = TextLayoutCache.layoutWidth(labelWidth)
+        for (label, text) in [(titleLabel, title), (descriptionLabel, description)] {
+            guard let label = label else { continue }
+            let layout = cache.layout(for: text ?? "", font: label.font, width: width)
+            label.text = text
+            label.numberOfLines = layout.lineCount
+            label.preferredMaxLayoutWidth = width
+            label.frame.size = layout.size
+        }
+    }
+}
+
+extension TextLayoutCache {
+    /// Lays out the bubble texts of `markers` in the background, using the fonts and width
+    /// of `context`.
+    func prefetchInfoBubbles(for markers: [NMAMapMarker], context: NMAMapInfoBubbleCustomizationContext,
+                             completion: (() -> Void)? = nil) {
+        let width = context.labelWidth
+        var batches = [(texts: [String], font: UIFont)]()
+        if let font = context.titleLabel?.font {
+            batches.append((markers.flatMap { $0.title as String? }, font))
+        }
+        if let font = context.descriptionLabel?.font {
+            batches.append((markers.flatMap { $0.textDescription as String? }, font))
+        }
+        // One block, so `completion` runs after both lists are measured.
+        queue.async {
+            for batch in batches {
+                for text in batch.texts {
+                    _ = self.layout(for: text, font: batch.font, width: width)
+                }
+            }
+            if let completion = completion {
+                DispatchQueue.main.async(execute: completion)
+            }
+        }
+    }
+}
@@ -0,0 +1,239 @@
+//
+//  ZoomVisibilityIndex.swift
+//  GMTest
+//
+//  Created by Alex Dontsov on 17.10.26.
+//  Copyright © 2026 Kinect.Pro. All rights reserved.
+//
+
+import Foundation
+
+/// Objects whose visibility flipped between two zoom levels.
+struct ZoomVisibilityChange {
+    let shown: [NMAMapObject]
+    let hidden: [NMAMapObject]
+
+    var isEmpty: Bool {
+        return shown.isEmpty && hidden.isEmpty
+    }
+}
+
+/// Zoom-bucketed visibility bitsets across all objects, so a zoom change yields only the
+/// objects whose visibility flipped instead of asking every object `isVisible(atZoomLevel:)`.
+///
+/// The zoom range is cut into `bucketsPerLevel` buckets per level; bucket `b` holds one bit
+/// per object. For each boundary between neighboring buckets the index keeps the list of
+/// objects that flip there (rebuilt lazily from the XOR of the two bitsets after edits), so
+/// `changes(fromZoomLevel:toZoomLevel:)` costs the number of flips crossed, not the number
+/// of objects. Visibility is set per whole zoom level, as the SDK does, so one bucket per
+/// level is enough; more only help when `minZoom` is fractional.
+///
+/// The SDK keeps the ranges private, so set them through the index, which forwards them to
+/// the object.
+final class ZoomVisibilityIndex {
+
+    let minZoom: Float
+    let maxZoom: Float
+    let bucketsPerLevel: Int
+    let bucketCount: Int
+
+    fileprivate var objects: [NMAMapObject?] = []
+    fileprivate var freeSlots: [Int] = []
+    fileprivate var slots: [ObjectIdentifier: Int] = [:]
+    /// Word-major bitsets: bucket `b` of word `w` is `bits[w * bucketCount + b]`.
+    fileprivate var bits: [UInt64] = []
+    /// Objects that differ between bucket `b` and `b + 1`.
+    fileprivate var flips: [[Int32]]
+    fileprivate var staleFlips: [Bool]
+    /// Scratch bits for `changes`, all zero between calls.
+    fileprivate var parity: [UInt64] = []
+    fileprivate var seen: [UInt64] = []
+
+    init(minZoom: Float = 0, maxZoom: Float = 20, bucketsPerLevel: Int = 1) {
+        precondition(maxZoom > minZoom && bucketsPerLevel > 0, "ZoomVisibilityIndex: invalid zoom range")
+        self.minZoom = minZoom
+        self.maxZoom = maxZoom
+        self.bucketsPerLevel = bucketsPerLevel
+        bucketCount = Int(((maxZoom - minZoom) * Float(bucketsPerLevel)).rounded(.up)) + 1
+        flips = [[Int32]](repeating: [], count: bucketCount - 1)
+        staleFlips = [Bool](repeating: false, count: bucketCount - 1)
+    }
+
+    var count: Int {
+        return slots.count
+    }
+
+    func bucket(forZoomLevel zoomLevel: Float) -> Int {
+        let position = ((zoomLevel - minZoom) * Float(bucketsPerLevel)).rounded(.down)
+        return min(max(Int(position), 0), bucketCount - 1)
+    }
+
+    // MARK: Objects
+
+    /// Starts tracking `object`, visible at every zoom level (the SDK default).
+    func add(_ object: NMAMapObject) {
+        guard slots[ObjectIdentifier(object)] == nil else { return }
+        let slot: Int
+        if let free = freeSlots.popLast() {
+            slot = free
+            objects[slot] = object
+        } else {
+            slot = objects.count
+            objects.append(object)
+            if slot % 64 == 0 {
+                bits.append(contentsOf: [UInt64](repeating: 0, count: bucketCount))
+                parity.append(0)
+                seen.append(0)
+            }
+        }
+        slots[ObjectIdentifier(object)] = slot
+        setBits(slot, from: 0, to: bucketCount - 1, visible: true)
+    }
+
+    func remove(_ object: NMAMapObject) {
+        guard let slot = slots.removeValue(forKey: ObjectIdentifier(object)) else { return }
+        setBits(slot, from: 0, to: bucketCount - 1, visible: false)
+        objects[slot] = nil
+        freeSlots.append(slot)
+    }
+
+    // MARK: Visibility
+
+    /// Calls `setVisibility(_:fromZoomLevel:toZoomLevel:)` on `object` and records it the way
+    /// the SDK applies it: both ends rounded to the nearest level, every level in between
+    /// set as a whole, `toZoomLevel` up to the end of its level.
+    func setVisibility(_ visible: Bool, of object: NMAMapObject, fromZoomLevel: Float, toZoomLevel: Float) {
+        object.setVisibility(visible, fromZoomLevel: fromZoomLevel, toZoomLevel: toZoomLevel)
+        add(object)
+        guard let slot = slots[ObjectIdentifier(object)] else { return }
+        setLevels(slot, from: level(forZoomLevel: fromZoomLevel), to: level(forZoomLevel: toZoomLevel), visible: visible)
+    }
+
+    /// Calls `setVisibility(_:atZoomLevel:)` on `object` and records it for the whole level
+    /// the SDK rounds `zoomLevel` to (14.1 means [14..15)).
+    func setVisibility(_ visible: Bool, of object: NMAMapObject, atZoomLevel zoomLevel: Float) {
+        object.setVisibility(visible, atZoomLevel: zoomLevel)
+        add(object)
+        guard let slot = slots[ObjectIdentifier(object)] else { return }
+        let level = self.level(forZoomLevel: zoomLevel)
+        setLevels(slot, from: level, to: level, visible: visible)
+    }
+
+    func isVisible(_ object: NMAMapObject, atZoomLevel zoomLevel: Float) -> Bool {
+        guard let slot = slots[ObjectIdentifier(object)] else { return object.isVisible(atZoomLevel: zoomLevel) }
+        return bit(slot, bucket: bucket(forZoomLevel: zoomLevel))
+    }
+
+    func visibleObjects(atZoomLevel zoomLevel: Float) -> [NMAMapObject] {
+        let b = bucket(forZoomLevel: zoomLevel)
+        var result = [NMAMapObject]()
+        for word in 0..<parity.count {
+            var remaining = bits[word * bucketCount + b]
+            while remaining != 0 {
+                let bit = Int(ffsll(Int64(bitPattern: remaining))) - 1
+                remaining &= remaining - 1
+                if let object = objects[word * 64 + bit] {
+                    result.append(object)
+                }
+            }
+        }
+        return result
+    }
+
+    /// Objects whose visibility differs between the two zoom levels.
+    func changes(fromZoomLevel: Float, toZoomLevel: Float) -> ZoomVisibilityChange {
+        let from = bucket(forZoomLevel: fromZoomLevel)
+        let to = bucket(forZoomLevel: toZoomLevel)
+        guard from != to else { return ZoomVisibilityChange(shown: [], hidden: []) }
+
+        // An object flipping at an even number of crossed boundaries ends where it started.
+        var touched = [Int]()
+        for boundary in min(from, to)..<max(from, to) {
+            for slot in flipList(boundary) {
+                let s = Int(slot)
+                let mask: UInt64 = 1 << UInt64(s % 64)
+                if seen[s / 64] & mask == 0 {
+                    seen[s / 64] |= mask
+                    touched.append(s)
+                }
+                parity[s / 64] ^= mask
+            }
+        }
+
+        var shown = [NMAMapObject]()
+        var hidden = [NMAMapObject]()
+        for slot in touched {
+            let mask: UInt64 = 1 << UInt64(slot % 64)
+            let flipped = parity[slot / 64] & mask != 0
+            parity[slot / 64] &= ~mask
+            seen[slot / 64] &= ~mask
+            guard flipped, let object = objects[slot] else { continue }
+            if bit(slot, bucket: to) {
+                shown.append(object)
+            } else {
+                hidden.append(object)
+            }
+        }
+        return ZoomVisibilityChange(shown: shown, hidden: hidden)
+    }
+
+    // MARK: Bits
+
+    /// Whole zoom level the SDK uses for a visibility argument.
+    fileprivate func level(forZoomLevel zoomLevel: Float) -> Int {
+        return Int(min(max(zoomLevel, minZoom), maxZoom).rounded())
+    }
+
+    /// Sets the buckets of levels `first...last`, i.e. zooms [first, last + 1).
+    fileprivate func setLevels(_ slot: Int, from first: Int, to last: Int, visible: Bool) {
+        guard first <= last else { return }
+        let scale = Float(bucketsPerLevel)
+        let firstBucket = max(Int(((Float(first) - minZoom) * scale).rounded(.up)), 0)
+        let lastBucket = min(Int(((Float(last + 1) - minZoom) * scale).rounded(.up)) - 1, bucketCount - 1)
+        if firstBucket <= lastBucket {
+            setBits(slot, from: firstBucket, to: lastBucket, visible: visible)
+        }
+    }
+
+    fileprivate func bit(_ slot: Int, bucket: Int) -> Bool {
+        return bits[(slot / 64) * bucketCount + bucket] & (1 << UInt64(slot % 64)) != 0
+    }
+
+    fileprivate func setBits(_ slot: Int, from first: Int, to last: Int, visible: Bool) {
+        let base = (slot / 64) * bucketCount
+        let mask: UInt64 = 1 << UInt64(slot % 64)
+        // Boundaries around the edited range where this object's flip state changes.
+        let low = max(first - 1, 0), high = min(last, bucketCount - 2)
+        var before = [Bool]()
+        if low <= high {
+            for boundary in low...high {
+                before.append((bits[base + boundary] ^ bits[base + boundary + 1]) & mask != 0)
+            }
+        }
+        for b in first...last {
+            bits[base + b] = visible ? bits[base + b] | mask : bits[base + b] & ~mask
+        }
+        if low <= high {
+            for boundary in low...high where before[boundary - low] != ((bits[base + boundary] ^ bits[base + boundary + 1]) & mask != 0) {
+                staleFlips[boundary] = true
+            }
+        }
+    }
+
+    fileprivate func flipList(_ boundary: Int) -> [Int32] {
+        if staleFlips[boundary] {
+            var list = [Int32]()
+            for word in 0..<parity.count {
+                var remaining = bits[word * bucketCount + boundary] ^ bits[word * bucketCount + boundary + 1]
+                while remaining != 0 {
+                    let bit = Int(ffsll(Int64(bitPattern: remaining))) - 1
+                    remaining &= remaining - 1
+                    list.append(Int32(word * 64 + bit))
+                }
+            }
+            flips[boundary] = list
+            staleFlips[boundary] = false
+        }
+        return flips[boundary]
+    }
+}